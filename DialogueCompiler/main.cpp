@@ -0,0 +1,30 @@
+#include "../TextRPG/DialogueCompiler.h"
+#include <exception>
+#include <iostream>
+#include <string>
+
+/*
+ * Compiles a TextRPG dialogue script into the image the game maps at startup.
+ *
+ *   DialogueCompiler <script.dlg> <image.dlgc>
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: DialogueCompiler <script.dlg> <image.dlgc>" << std::endl;
+        return 1;
+    }
+
+    try {
+        CompiledDialogues compiled = compileDialogueFile(argv[1], argv[2]);
+        for (auto& warning : compiled.warnings)
+            std::cerr << "[!] " << warning << std::endl;
+        std::cout << "[+] Compiled " << compiled.graph.size() << " dialogues, "
+            << compiled.graph.choiceTotal() << " choices and "
+            << compiled.graph.actionTotal() << " actions into " << argv[2] << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[-] " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
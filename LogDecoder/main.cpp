@@ -0,0 +1,87 @@
+#include "../TextRPG/LogBinary.h"
+#include "../TextRPG/LogCompression.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+/*
+ * Turns a binary TextRPG log (built with LOG_BINARY) back into the text
+ * lines log.txt would have contained. Rotated ".lz" segments are unpacked
+ * first, so text segments can be read with it too.
+ *
+ *   LogDecoder [log.bin] [-o output.txt] [--monotonic]
+ */
+int main(int argc, char* argv[]) {
+    std::string inputPath = "log.bin";
+    std::string outputPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--monotonic") {
+            setSubSecondTimestamps(true);
+        }
+        else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: LogDecoder [log.bin] [-o output.txt] [--monotonic]" << std::endl;
+            return 0;
+        }
+        else {
+            inputPath = arg;
+        }
+    }
+
+    std::ifstream inputFile(inputPath, std::ios::binary);
+    if (!inputFile) {
+        std::cerr << "[-] Can't open " << inputPath << std::endl;
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+
+    if (isCompressedLog(data)) {
+        try {
+            data = decompressLog(data);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[-] " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream outputFile;
+    if (!outputPath.empty()) {
+        outputFile.open(outputPath);
+        if (!outputFile) {
+            std::cerr << "[-] Can't open " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = outputPath.empty() ? std::cout : outputFile;
+
+    if (data.empty() || data[0] != static_cast<char>(LogFrameType::SESSION)) {
+        output << data;
+        return 0;
+    }
+
+    std::istringstream input(data);
+
+    LogBinaryDecoder decoder;
+    size_t records = 0;
+    try {
+        while (decoder.next(input, output))
+            ++records;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[-] Stopped after " << records << " records: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!decoder.getError().empty()) {
+        std::cerr << "[-] Stopped after " << records << " records: " << decoder.getError() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,7 +1,55 @@
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <random>
 #include <string>
 
 
+/* xoshiro128** generator; the same seed gives the same fight */
+class Random
+{
+private:
+    uint32_t state[4];
+
+    static uint32_t rotate(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+    static uint64_t splitMix64(uint64_t& value)
+    {
+        uint64_t z = (value += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+public:
+    explicit Random(uint64_t seed)
+    {
+        uint64_t low = splitMix64(seed);
+        uint64_t high = splitMix64(seed);
+        state[0] = static_cast<uint32_t>(low);
+        state[1] = static_cast<uint32_t>(low >> 32);
+        state[2] = static_cast<uint32_t>(high);
+        state[3] = static_cast<uint32_t>(high >> 32);
+    }
+
+    uint32_t next()
+    {
+        uint32_t result = rotate(state[1] * 5, 7) * 9;
+        uint32_t shifted = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate(state[3], 11);
+        return result;
+    }
+
+    // true with the given chance in percent
+    bool chance(uint32_t percent) { return ((static_cast<uint64_t>(next()) * 100) >> 32) < percent; }
+};
+
+
 class Entity
 {
 protected:
@@ -43,7 +91,7 @@ public:
         }
     }
 
-    virtual void attackEnemy(Entity& target)
+    virtual void attackEnemy(Entity& target, Random&)
     {
         std::cout << name << " attacks " << target.name << " >> ";
         int damage = attack - target.defense;
@@ -76,11 +124,11 @@ public:
         }
     }
 
-    void attackEnemy(Entity& target) override
+    void attackEnemy(Entity& target, Random& random) override
     {
         int damage = attack - target.getDefense();
 
-        bool isCriticalHit = (rand() % 100) < 20;
+        bool isCriticalHit = random.chance(20);
         if (isCriticalHit)
             std::cout << name << " attacks " << target.getName() << " with critical hit x2 >> ";
         target.takeDamage(isCriticalHit ? damage * 2 : damage);
@@ -99,11 +147,11 @@ public:
     Monster(const std::string& name, int health, int attack, int defense)
         : Entity(name, health, attack, defense) {}
 
-    void attackEnemy(Entity& target) override
+    void attackEnemy(Entity& target, Random& random) override
     {
         int damage = attack - target.getDefense();
 
-        bool hasExtraDamage = rand() % 100 < 30;
+        bool hasExtraDamage = random.chance(30);
         if (hasExtraDamage)
             std::cout << name << " attacks " << target.getName() << " with extra damage +5 >> ";
         target.takeDamage(hasExtraDamage ? damage + 5 : damage);
@@ -131,11 +179,11 @@ public:
         std::cout << "Special Ability: " << specialAbility << std::endl;
     }
 
-    void attackEnemy(Entity& target) override
+    void attackEnemy(Entity& target, Random& random) override
     {
         int damage = attack - target.getDefense();
 
-        bool isSpecialAttack = (rand() % 100) < 20;
+        bool isSpecialAttack = random.chance(20);
         if (isSpecialAttack)
             std::cout << name << " uses " << specialAbility << " >> ";
         target.takeDamage(isSpecialAttack ? damage * 4 : damage);
@@ -143,7 +191,12 @@ public:
 };
 
 
-int main() {
+// Run with the printed seed to see the same fight again
+int main(int argc, char* argv[]) {
+    uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::random_device()();
+    std::cout << "Seed: " << seed << std::endl;
+    Random random(seed);
+
     Character player("Player", 100, 20, 10);
     Monster goblin("goblin", 50, 15, 5);
     Boss dragon("Dragon", 150, 25, 20, "Fireball");
@@ -156,16 +209,16 @@ int main() {
     }
 
     std::cout << "\n[~] Player attacks enemies:\n" << std::endl;
-    player.attackEnemy(goblin);
-    player.attackEnemy(dragon);
+    player.attackEnemy(goblin, random);
+    player.attackEnemy(dragon, random);
 
     std::cout << "\n[~] Goblin attacks enemies:\n" << std::endl;
-    goblin.attackEnemy(player);
-    goblin.attackEnemy(dragon);
+    goblin.attackEnemy(player, random);
+    goblin.attackEnemy(dragon, random);
 
     std::cout << "\n[~] Dragon attacks enemies:\n" << std::endl;
-    dragon.attackEnemy(player);
-    dragon.attackEnemy(goblin);
+    dragon.attackEnemy(player, random);
+    dragon.attackEnemy(goblin, random);
 
     std::cout << "\n[~] Player heals 10 hp:\n" << std::endl;
     player.heal(10);
@@ -6,6 +6,52 @@
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <cstdint>
+#include <random>
+
+/* xoshiro128** generator, owned by the fight thread; the same seed gives the same fight */
+class Random
+{
+private:
+    uint32_t state[4];
+
+    static uint32_t rotate(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+    static uint64_t splitMix64(uint64_t& value)
+    {
+        uint64_t z = (value += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+public:
+    explicit Random(uint64_t seed)
+    {
+        uint64_t low = splitMix64(seed);
+        uint64_t high = splitMix64(seed);
+        state[0] = static_cast<uint32_t>(low);
+        state[1] = static_cast<uint32_t>(low >> 32);
+        state[2] = static_cast<uint32_t>(high);
+        state[3] = static_cast<uint32_t>(high >> 32);
+    }
+
+    uint32_t next()
+    {
+        uint32_t result = rotate(state[1] * 5, 7) * 9;
+        uint32_t shifted = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate(state[3], 11);
+        return result;
+    }
+
+    // true with the given chance in percent
+    bool chance(uint32_t percent) { return ((static_cast<uint64_t>(next()) * 100) >> 32) < percent; }
+};
 
 /* Entity classes */
 class Entity
@@ -55,7 +101,7 @@ public:
         }
     }
 
-    virtual void attackEnemy(Entity& target)
+    virtual void attackEnemy(Entity& target, Random&)
     {
         std::cout << name << " attacks " << target.name << " >> ";
         int damage = attack - target.defense;
@@ -88,14 +134,14 @@ public:
         }
     }
 
-    void attackEnemy(Entity& target) override
+    void attackEnemy(Entity& target, Random& random) override
     {
         if (target.getHealth() == 0)
             return;
 
         int damage = attack - target.getDefense();
 
-        bool isCriticalHit = (rand() % 100) < 20;
+        bool isCriticalHit = random.chance(20);
         if (isCriticalHit)
             std::cout << "\033[35m" << name << " attacks " << target.getName() << " with critical hit x2 >> ";
         else
@@ -117,11 +163,11 @@ public:
     Monster(const std::string& name, int health, int attack, int defense)
         : Entity(name, health, attack, defense) {}
 
-    void attackEnemy(Entity& target) override
+    void attackEnemy(Entity& target, Random& random) override
     {
         int damage = attack - target.getDefense();
 
-        bool hasExtraDamage = rand() % 100 < 30;
+        bool hasExtraDamage = random.chance(30);
         if (hasExtraDamage)
             std::cout << "\033[35m" << name << " attacks " << target.getName() << " with extra damage +5 >> ";
         else
@@ -154,7 +200,7 @@ void generateMonsters() {
 }
 
 /* Function of calculating fight */
-void fight(Character& hero) {
+void fight(Character& hero, Random& random) {
     while (heroAlive)
     {
         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -162,17 +208,17 @@ void fight(Character& hero) {
         std::lock_guard<std::mutex> lock(monstersMutex);
         for (auto& monster : monsters)
         {
-            if (rand() % 100 < 50 ? false : true)
+            if (random.chance(50))
                 std::cout << "\033[33m" << "Hero misses the attack!" << "\033[0m" << std::endl;
             else
-                hero.attackEnemy(monster);
+                hero.attackEnemy(monster, random);
             
             std::this_thread::sleep_for(std::chrono::seconds(1));
 
-            if (rand() % 100 < 50 ? false : true)
+            if (random.chance(50))
                 std::cout << "\033[33m" << "Monster misses the attack!" << "\033[0m" << std::endl;
             else
-                monster.attackEnemy(hero);
+                monster.attackEnemy(hero, random);
 			
 
             if (hero.getHealth() <= 0)
@@ -186,14 +232,19 @@ void fight(Character& hero) {
 }
 
 /* Main function */
-int main() {
+int main(int argc, char* argv[]) {
+    /* Seed of the fight; run with the printed one to replay it */
+    uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::random_device()();
+    std::cout << "Seed: " << seed << std::endl;
+    Random random(seed);
+
     /* Monster generator thread */
     std::thread monsterGenerator(generateMonsters);
     monsterGenerator.detach();
 
     Character hero("Hero", 100, 20, 10);
 
-    std::thread fightThread(fight, std::ref(hero));
+    std::thread fightThread(fight, std::ref(hero), std::ref(random));
 	fightThread.detach();
     
     while (heroAlive)
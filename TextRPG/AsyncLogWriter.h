@@ -0,0 +1,256 @@
+#pragma once
+#include "LogRecord.h"
+#include "LogSink.h"
+#include "LogQueue.h"
+#include "LogRateLimit.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class OverflowPolicy {
+    BLOCK,
+    DROP_OLDEST,
+    DROP_NEWEST
+};
+
+struct AsyncLogOptions {
+    size_t capacity = 8192;
+    size_t batchSize = 256;
+    std::chrono::milliseconds flushInterval{ 200 };
+    OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+};
+
+struct AsyncLogEntry {
+    LogRecord record;
+    std::string loggerName;
+    std::shared_ptr<LogSink> sink;
+};
+
+/*
+ * One background thread shared by every Logger. Callers copy their record
+ * into LogQueue and return; the writer drains it, writes into the sinks and
+ * flushes them once batchSize records are pending or flushInterval passes.
+ */
+class AsyncLogWriter {
+private:
+    AsyncLogOptions options;
+    LogQueue<AsyncLogEntry> queue;
+    std::thread worker;
+
+    std::atomic<bool> running{ false };
+    bool stopping = false;
+    bool flushRequested = false;
+
+    std::atomic<uint64_t> submitted{ 0 };
+    std::atomic<uint64_t> completed{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable flushedCondition;
+
+    // Only touched by the writer thread
+    LogRecord suppressedReport{ LogLevel::INFO, std::string(), 0 };
+
+    AsyncLogWriter() {
+        // The writer drains into sinks on shutdown, so the registry (and the
+        // compressor it owns) must be destroyed after it
+        LogSinkRegistry::instance();
+    }
+
+    void wake() { wakeCondition.notify_one(); }
+
+    void rememberSink(std::vector<std::shared_ptr<LogSink>>& touched, const std::shared_ptr<LogSink>& sink) {
+        if (!touched.empty() && touched.back() == sink)
+            return;
+        for (auto& known : touched) {
+            if (known == sink)
+                return;
+        }
+        touched.push_back(sink);
+    }
+
+    /*
+     * Counts of rate-limited LOG_* sites that went quiet would otherwise wait
+     * for the site's next hit. They go straight into the default sink, since
+     * a site is not tied to one logger; all of them at shutdown.
+     */
+    void reportSuppressed(std::vector<std::shared_ptr<LogSink>>& touched, bool all) {
+        std::shared_ptr<LogSink> sink;
+        sweepSuppressedLogSites(all, [&](const LogSite& site, LogLevel level, uint64_t count) {
+            if (!sink)
+                sink = LogSinkRegistry::instance().acquireDefault();
+            LogRecord& record = suppressedReport;
+            record.level = level;
+            record.message.clear();
+            encodeLogArgs(record.message, count, site.fileName(), site.line);
+            record.timestamp = std::time(nullptr);
+            record.monotonicNs = subSecondTimestamps() ? monotonicNanoseconds() : 0;
+            record.format = "Suppressed {} messages at {}:{}";
+            sink->write(record, "LogSite");
+            rememberSink(touched, sink);
+            });
+    }
+
+    void run() {
+        std::vector<std::shared_ptr<LogSink>> touched;
+        auto lastFlush = std::chrono::steady_clock::now();
+        uint64_t unflushed = 0;
+
+        for (;;) {
+            size_t drained = 0;
+            while (drained < options.batchSize && queue.tryPop([&](AsyncLogEntry& entry) {
+                entry.sink->write(entry.record, entry.loggerName);
+                rememberSink(touched, entry.sink);
+                entry.sink.reset();
+                })) {
+                ++drained;
+            }
+            unflushed += drained;
+
+            bool empty = queue.size() == 0;
+            bool stopNow;
+            bool flushNow;
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                stopNow = stopping && empty;
+                flushNow = unflushed >= options.batchSize || (empty && (flushRequested || stopNow))
+                    || std::chrono::steady_clock::now() - lastFlush >= options.flushInterval;
+            }
+
+            if (flushNow) {
+                reportSuppressed(touched, stopNow);
+                for (auto& sink : touched)
+                    sink->flush();
+                touched.clear();
+                lastFlush = std::chrono::steady_clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex);
+                    completed.fetch_add(unflushed);
+                    if (empty)
+                        flushRequested = false;
+                }
+                unflushed = 0;
+                flushedCondition.notify_all();
+            }
+
+            if (stopNow)
+                return;
+
+            if (drained == options.batchSize)
+                continue;
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, options.flushInterval, [this] {
+                return stopping || flushRequested || queue.size() >= options.batchSize;
+                });
+        }
+    }
+
+public:
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    ~AsyncLogWriter() { stop(); }
+
+    static AsyncLogWriter& instance() {
+        static AsyncLogWriter writer;
+        return writer;
+    }
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    uint64_t droppedCount() const { return dropped.load(); }
+    const AsyncLogOptions& getOptions() const { return options; }
+
+    void start(const AsyncLogOptions& value = AsyncLogOptions()) {
+        if (isRunning())
+            return;
+        if (value.capacity == 0 || value.batchSize == 0)
+            throw std::invalid_argument("Async log capacity and batch size must be greater than 0");
+
+        options = value;
+        queue.reset(options.capacity);
+        stopping = false;
+        flushRequested = false;
+        worker = std::thread(&AsyncLogWriter::run, this);
+        running.store(true, std::memory_order_release);
+    }
+
+    /* Drains everything already queued, then joins the writer thread */
+    void stop() {
+        if (!isRunning())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake();
+        worker.join();
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            running.store(false, std::memory_order_release);
+        }
+        flushedCondition.notify_all();
+    }
+
+    bool submit(const LogRecord& record, const std::string& loggerName, const std::shared_ptr<LogSink>& sink) {
+        for (;;) {
+            bool pushed = queue.tryPush([&](AsyncLogEntry& entry) {
+                entry.record.level = record.level;
+                entry.record.message.assign(record.message);
+                entry.record.timestamp = record.timestamp;
+                entry.record.monotonicNs = record.monotonicNs;
+                entry.record.format = record.format;
+                entry.loggerName.assign(loggerName);
+                entry.sink = sink;
+                });
+
+            if (pushed) {
+                submitted.fetch_add(1);
+                if (queue.size() >= options.batchSize)
+                    wake();
+                return true;
+            }
+
+            switch (options.overflowPolicy) {
+                case OverflowPolicy::DROP_NEWEST:
+                    dropped.fetch_add(1);
+                    LogMetrics::recordDropped();
+                    return false;
+                case OverflowPolicy::DROP_OLDEST:
+                    if (queue.tryPop([](AsyncLogEntry& entry) { entry.sink.reset(); })) {
+                        dropped.fetch_add(1);
+                        completed.fetch_add(1);
+                        LogMetrics::recordDropped();
+                    }
+                    break;
+                case OverflowPolicy::BLOCK:
+                default:
+                    wake();
+                    std::this_thread::yield();
+                    break;
+            }
+        }
+    }
+
+    /* Blocks until every record submitted before the call is on disk */
+    void flush() {
+        if (!isRunning())
+            return;
+        uint64_t target = submitted.load();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        flushRequested = true;
+        wakeCondition.notify_one();
+        flushedCondition.wait(lock, [&] {
+            return completed.load() >= target || !isRunning();
+            });
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_DAMAGE_SSE2 1
+#include <emmintrin.h>
+#else
+#define BATCH_DAMAGE_SSE2 0
+#endif
+
+enum class DamageResult : uint8_t {
+    NO_DAMAGE,
+    DAMAGED,
+    DIED
+};
+
+/* What one target of a batch went through, the same cases Entity::takeDamage prints */
+struct DamageEvent {
+    uint32_t target;
+    int32_t damage;
+    int32_t healthLeft;
+    DamageResult result;
+};
+
+namespace batch_damage {
+
+// Alive flags of four lanes, indexed by the movemask of their "health > 0" compare
+const uint32_t laneFlags[16] = {
+    0x00000000, 0x00000001, 0x00000100, 0x00000101, 0x00010000, 0x00010001, 0x00010100, 0x00010101,
+    0x01000000, 0x01000001, 0x01000100, 0x01000101, 0x01010000, 0x01010001, 0x01010100, 0x01010101
+};
+const uint8_t laneCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+inline size_t resolveScalar(int32_t* health, const int32_t* defense, const int32_t* amounts, int32_t amount,
+    uint8_t* alive, int32_t* taken, size_t from, size_t count) {
+    size_t deaths = 0;
+    for (size_t i = from; i < count; ++i) {
+        int32_t lost = (amounts ? amounts[i] : amount) - defense[i];
+        lost = lost > 0 ? lost : 0;
+        int32_t left = health[i] - lost;
+        left = left > 0 ? left : 0;
+        deaths += health[i] > 0 && left == 0 ? 1 : 0;
+        taken[i] = health[i] - left;
+        health[i] = left;
+        alive[i] = left > 0 ? 1 : 0;
+    }
+    return deaths;
+}
+
+#if BATCH_DAMAGE_SSE2
+template <bool PerTarget>
+size_t resolveSse2(int32_t* health, const int32_t* defense, const int32_t* amounts, int32_t amount,
+    uint8_t* alive, int32_t* taken, size_t& done, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uniform = _mm_set1_epi32(amount);
+    size_t deaths = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i hp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(health + i));
+        __m128i attack = PerTarget ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(amounts + i)) : uniform;
+        __m128i lost = _mm_sub_epi32(attack, _mm_loadu_si128(reinterpret_cast<const __m128i*>(defense + i)));
+        // SSE2 has no max_epi32: x & (x > 0) clamps at 0
+        lost = _mm_and_si128(lost, _mm_cmpgt_epi32(lost, zero));
+        __m128i left = _mm_sub_epi32(hp, lost);
+        __m128i living = _mm_cmpgt_epi32(left, zero);
+        left = _mm_and_si128(left, living);
+        __m128i died = _mm_andnot_si128(living, _mm_cmpgt_epi32(hp, zero));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(health + i), left);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(taken + i), _mm_sub_epi32(hp, left));
+        std::memcpy(alive + i, &laneFlags[_mm_movemask_ps(_mm_castsi128_ps(living))], 4);
+        deaths += laneCounts[_mm_movemask_ps(_mm_castsi128_ps(died))];
+    }
+    done = i;
+    return deaths;
+}
+#endif
+
+}
+
+/*
+ * takeDamage for count targets at once: each loses amounts[i] (or amount
+ * when amounts is null) minus its defense, never below 0 health. Writes the
+ * new health and alive flags, the health each target lost to taken, and
+ * returns how many died. Four targets per step with SSE2, one at a time
+ * elsewhere; the results are the same.
+ */
+inline size_t resolveBatchDamage(int32_t* health, const int32_t* defense, const int32_t* amounts, int32_t amount,
+    uint8_t* alive, int32_t* taken, size_t count) {
+    size_t done = 0;
+    size_t deaths = 0;
+#if BATCH_DAMAGE_SSE2
+    deaths = amounts ? batch_damage::resolveSse2<true>(health, defense, amounts, amount, alive, taken, done, count)
+        : batch_damage::resolveSse2<false>(health, defense, amounts, amount, alive, taken, done, count);
+#endif
+    return deaths + batch_damage::resolveScalar(health, defense, amounts, amount, alive, taken, done, count);
+}
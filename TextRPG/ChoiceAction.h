@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Callables up to this size are stored inside the ChoiceAction itself
+const size_t choiceActionInlineSize = 48;
+
+/*
+ * Move-only callable run when a dialogue choice is picked. Lambdas whose
+ * captures fit in choiceActionInlineSize bytes are stored in place, so
+ * storing one allocates nothing; calling it is one indirect call through a
+ * function pointer made for exactly that lambda type. Larger callables are
+ * moved to the heap.
+ */
+template <typename Context>
+class ChoiceAction {
+private:
+    typedef void (*Invoke)(void* storage, Context* context);
+    typedef void (*Manage)(void* from, void* to);
+
+    // Never null, so a call needs no emptiness check
+    Invoke invoke = &invokeEmpty;
+    // Moves from into to and destroys from; with to == nullptr only destroys
+    Manage manage = nullptr;
+    alignas(std::max_align_t) unsigned char storage[choiceActionInlineSize];
+
+    static void invokeEmpty(void*, Context*) {
+        throw std::logic_error("Empty choice action called");
+    }
+
+    template <typename F>
+    struct Inline {
+        static F& get(void* storage) { return *static_cast<F*>(storage); }
+        static void invoke(void* storage, Context* context) { get(storage)(context); }
+        static void manage(void* from, void* to) {
+            if (to)
+                new (to) F(std::move(get(from)));
+            get(from).~F();
+        }
+    };
+
+    template <typename F>
+    struct Boxed {
+        static F*& get(void* storage) { return *static_cast<F**>(storage); }
+        static void invoke(void* storage, Context* context) { (*get(storage))(context); }
+        static void manage(void* from, void* to) {
+            if (to)
+                new (to) F*(get(from));
+            else
+                delete get(from);
+        }
+    };
+
+    template <typename F>
+    using fitsInline = std::integral_constant<bool,
+        sizeof(F) <= choiceActionInlineSize && alignof(std::max_align_t) % alignof(F) == 0
+        && std::is_nothrow_move_constructible<F>::value>;
+
+    template <typename F>
+    void store(F&& callable, std::true_type) {
+        typedef typename std::decay<F>::type Stored;
+        new (storage) Stored(std::forward<F>(callable));
+        invoke = &Inline<Stored>::invoke;
+        manage = &Inline<Stored>::manage;
+    }
+
+    template <typename F>
+    void store(F&& callable, std::false_type) {
+        typedef typename std::decay<F>::type Stored;
+        new (storage) Stored*(new Stored(std::forward<F>(callable)));
+        invoke = &Boxed<Stored>::invoke;
+        manage = &Boxed<Stored>::manage;
+    }
+
+    void reset() {
+        if (manage)
+            manage(storage, nullptr);
+        invoke = &invokeEmpty;
+        manage = nullptr;
+    }
+
+    void take(ChoiceAction& other) noexcept {
+        if (!other.manage)
+            return;
+        other.manage(other.storage, storage);
+        invoke = other.invoke;
+        manage = other.manage;
+        other.invoke = &invokeEmpty;
+        other.manage = nullptr;
+    }
+
+public:
+    ChoiceAction() = default;
+    ChoiceAction(std::nullptr_t) {}
+
+    // A ChoiceAction is itself callable with a Context*, so it has to be ruled out here or copies would wrap themselves
+    template <typename F, typename = decltype(std::declval<typename std::decay<F>::type&>()(std::declval<Context*>())),
+        typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, ChoiceAction>::value>::type>
+    ChoiceAction(F&& callable) {
+        store(std::forward<F>(callable), fitsInline<typename std::decay<F>::type>());
+    }
+
+    ChoiceAction(ChoiceAction&& other) noexcept { take(other); }
+
+    ChoiceAction& operator=(ChoiceAction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ChoiceAction(const ChoiceAction&) = delete;
+    ChoiceAction& operator=(const ChoiceAction&) = delete;
+
+    ~ChoiceAction() { reset(); }
+
+    explicit operator bool() const { return manage != nullptr; }
+
+    void operator()(Context* context) { invoke(storage, context); }
+};
+
+static_assert(!std::is_constructible<ChoiceAction<void>, ChoiceAction<void>&>::value
+    && !std::is_constructible<ChoiceAction<void>, const ChoiceAction<void>&>::value
+    && !std::is_assignable<ChoiceAction<void>&, ChoiceAction<void>&>::value,
+    "ChoiceAction is move-only");
@@ -0,0 +1,97 @@
+#pragma once
+#include "LogArgs.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Streaming encoding of a DialogueSystem choice log. Each entry is a varint
+ * (zigzag(choice) << 1 | run); run entries are followed by a varint repeat
+ * count, so long stretches of choiceless dialogues (-1) or of the same
+ * answer take two bytes. Choices up to 31 fit in a single byte.
+ *
+ * The log is stored as frames: [firstIndex][count][byteLength][entries].
+ * Reading a frame drops everything from firstIndex on before appending, so
+ * a journal of frames can both extend the log and record a rewind.
+ */
+const size_t choiceRunThreshold = 3;
+// Sanity bounds against a corrupt frame header
+const uint64_t maxChoiceFrameBytes = 1ull << 30;
+const uint64_t maxChoiceCount = UINT32_MAX;
+
+inline uint64_t encodeChoice(int choice) {
+    return (static_cast<uint64_t>(static_cast<int64_t>(choice)) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(choice) >> 63);
+}
+
+inline int decodeChoice(uint64_t value) {
+    return static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+}
+
+/* Appends the entries [from, to) of choices to out */
+inline void encodeChoices(const std::vector<int>& choices, size_t from, size_t to, std::string& out) {
+    for (size_t i = from; i < to;) {
+        size_t end = i + 1;
+        while (end < to && choices[end] == choices[i])
+            ++end;
+        size_t repeat = end - i;
+        if (repeat >= choiceRunThreshold) {
+            appendVarint(out, encodeChoice(choices[i]) << 1 | 1);
+            appendVarint(out, repeat);
+            i = end;
+        }
+        else {
+            appendVarint(out, encodeChoice(choices[i]) << 1);
+            ++i;
+        }
+    }
+}
+
+/* Appends count decoded entries to choices; false on malformed input */
+inline bool decodeChoices(const char* data, const char* end, size_t count, std::vector<int>& choices) {
+    size_t target = choices.size() + count;
+    while (choices.size() < target) {
+        uint64_t value = 0;
+        if (!readVarint(data, end, value))
+            return false;
+        uint64_t repeat = 1;
+        if ((value & 1) && (!readVarint(data, end, repeat) || repeat > target - choices.size()))
+            return false;
+        choices.insert(choices.end(), static_cast<size_t>(repeat), decodeChoice(value >> 1));
+    }
+    return data == end;
+}
+
+/* Writes the entries [from, end) of choices as one frame; returns its size in bytes */
+inline size_t writeChoiceFrame(std::ostream& out, const std::vector<int>& choices, size_t from) {
+    std::string entries;
+    encodeChoices(choices, from, choices.size(), entries);
+    std::string header;
+    appendVarint(header, from);
+    appendVarint(header, choices.size() - from);
+    appendVarint(header, entries.size());
+    out.write(header.data(), header.size());
+    out.write(entries.data(), entries.size());
+    return header.size() + entries.size();
+}
+
+/* Applies one frame to choices; false at the end of the stream or on a bad frame */
+inline bool readChoiceFrame(std::istream& in, std::vector<int>& choices) {
+    uint64_t firstIndex = 0, count = 0, byteLength = 0;
+    if (!readVarint(in, firstIndex) || !readVarint(in, count) || !readVarint(in, byteLength))
+        return false;
+    if (firstIndex > choices.size() || byteLength > maxChoiceFrameBytes || count > maxChoiceCount)
+        return false;
+
+    std::string entries(static_cast<size_t>(byteLength), '\0');
+    if (byteLength > 0 && !in.read(&entries[0], entries.size()))
+        return false;
+    std::vector<int> tail;
+    if (!decodeChoices(entries.data(), entries.data() + entries.size(), static_cast<size_t>(count), tail))
+        return false;
+    choices.resize(static_cast<size_t>(firstIndex));
+    choices.insert(choices.end(), tail.begin(), tail.end());
+    return true;
+}
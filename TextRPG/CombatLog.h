@@ -0,0 +1,233 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class CombatEventType : uint8_t {
+    ATTACK,         // actor attacks target
+    DODGE,          // target dodged the attack of actor
+    NO_DAMAGE,      // actor takes no damage
+    DAMAGE,         // actor takes value damage, extra hp left
+    DEATH,          // actor takes value damage and dies
+    EXPERIENCE,     // actor gains value experience
+    LEVEL_UP,       // actor reaches level value
+    HEAL,           // actor drinks a Heal Potion
+    NO_POTION,      // actor has no Heal Potion
+    ITEM_USED,      // actor uses the item named target
+    ITEM_MISSING,   // actor has no item named target
+    VICTORY,        // every monster is dead
+    DEFEAT          // actor, the player, died
+};
+
+/* A name in the log's text buffer */
+struct CombatText {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct CombatEvent {
+    CombatEventType type;
+    int32_t value;
+    int32_t extra;
+    CombatText actor;
+    CombatText target;
+};
+
+class CombatLog;
+
+/* Turns the events of a log into output; one call per flush */
+class CombatRenderer {
+public:
+    virtual ~CombatRenderer() {}
+    virtual void render(const CombatLog& log) = 0;
+};
+
+/*
+ * Events of one fight in the order they happened. Entities push typed
+ * events instead of printing, and flush hands everything pending to the
+ * renderer at once. Without a renderer nothing is formatted or written, so
+ * headless fights pay for the pushes only. The buffers keep their capacity
+ * across flushes, so a long fight stops allocating after its first turns.
+ */
+class CombatLog {
+private:
+    std::vector<CombatEvent> events;
+    // Names of the events, back to back
+    std::string text;
+    std::shared_ptr<CombatRenderer> renderer;
+
+    CombatText store(const std::string& name) {
+        CombatText stored{ static_cast<uint32_t>(text.size()), static_cast<uint32_t>(name.size()) };
+        text += name;
+        return stored;
+    }
+
+public:
+    explicit CombatLog(std::shared_ptr<CombatRenderer> renderer = nullptr) : renderer(std::move(renderer)) {}
+
+    void setRenderer(std::shared_ptr<CombatRenderer> value) { renderer = std::move(value); }
+    const std::shared_ptr<CombatRenderer>& getRenderer() const { return renderer; }
+
+    void push(CombatEventType type, const std::string& actor, const std::string& target = std::string(), int32_t value = 0, int32_t extra = 0) {
+        CombatEvent event;
+        event.type = type;
+        event.value = value;
+        event.extra = extra;
+        event.actor = store(actor);
+        event.target = store(target);
+        events.push_back(event);
+    }
+
+    size_t size() const { return events.size(); }
+    bool empty() const { return events.empty(); }
+    const CombatEvent& operator[](size_t index) const { return events[index]; }
+
+    const char* textData(CombatText name) const { return text.data() + name.offset; }
+
+    /* Renders the pending events and drops them */
+    void flush() {
+        if (events.empty())
+            return;
+        if (renderer)
+            renderer->render(*this);
+        events.clear();
+        text.clear();
+    }
+};
+
+inline void appendCombatNumber(std::string& out, int32_t value) {
+    char digits[12];
+    char* begin = digits + sizeof(digits);
+    uint32_t rest = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    do {
+        *--begin = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+    } while (rest != 0);
+    if (value < 0)
+        *--begin = '-';
+    out.append(begin, digits + sizeof(digits));
+}
+
+/* The line an event stood for when Entity printed it, with or without the ANSI colors */
+inline void appendCombatEvent(std::string& out, const CombatLog& log, const CombatEvent& event, bool colors) {
+    auto actor = [&]() { out.append(log.textData(event.actor), event.actor.length); };
+    auto target = [&]() { out.append(log.textData(event.target), event.target.length); };
+    auto begin = [&](const char* color, const char* mark) {
+        if (colors)
+            out += color;
+        out += mark;
+    };
+
+    switch (event.type) {
+    case CombatEventType::ATTACK:
+        begin("\033[34m", "[~] ");
+        actor();
+        out += " attacking ";
+        target();
+        break;
+    case CombatEventType::DODGE:
+        begin("\033[31m", "[-] ");
+        target();
+        out += " dodged the attack ";
+        actor();
+        break;
+    case CombatEventType::NO_DAMAGE:
+        begin("\033[31m", "[-] ");
+        actor();
+        out += " takes no damage";
+        break;
+    case CombatEventType::DAMAGE:
+        begin("\033[32m", "[+] ");
+        actor();
+        out += " takes ";
+        appendCombatNumber(out, event.value);
+        out += " damage, ";
+        appendCombatNumber(out, event.extra);
+        out += " hp left";
+        break;
+    case CombatEventType::DEATH:
+        begin("\033[32m", "[+] ");
+        actor();
+        out += " takes ";
+        appendCombatNumber(out, event.value);
+        out += " damage and died";
+        break;
+    case CombatEventType::EXPERIENCE:
+        begin("\033[32m", "[+] Gained ");
+        appendCombatNumber(out, event.value);
+        out += " experience";
+        break;
+    case CombatEventType::LEVEL_UP:
+        begin("\033[32m", "[+] Leveled up");
+        break;
+    case CombatEventType::HEAL:
+        begin("\033[32m", "[~] Item Heal Potion successfully used, healed 25hp");
+        break;
+    case CombatEventType::NO_POTION:
+        begin("\033[31m", "[~] Item Heal Potion not found in inventory");
+        break;
+    case CombatEventType::ITEM_USED:
+        begin("\033[32m", "[~] Item ");
+        target();
+        out += " successfully used";
+        break;
+    case CombatEventType::ITEM_MISSING:
+        begin("\033[31m", "[~] Item ");
+        target();
+        out += " not found in inventory";
+        break;
+    case CombatEventType::VICTORY:
+        begin("\033[32m", "[~] Monsters defeated!");
+        break;
+    case CombatEventType::DEFEAT:
+        begin("\033[31m", "[-] The player died from the injuries");
+        break;
+    }
+    if (colors)
+        out += "\033[0m";
+    out += '\n';
+}
+
+/* Colored lines on a stream, one write and one flush per batch instead of per line */
+class ConsoleCombatRenderer : public CombatRenderer {
+private:
+    std::ostream& out;
+    std::string buffer;
+
+public:
+    explicit ConsoleCombatRenderer(std::ostream& out = std::cout) : out(out) {}
+
+    void render(const CombatLog& log) override {
+        buffer.clear();
+        for (size_t i = 0; i < log.size(); ++i)
+            appendCombatEvent(buffer, log, log[i], true);
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.flush();
+    }
+};
+
+/* Plain lines appended to a file */
+class FileCombatRenderer : public CombatRenderer {
+private:
+    std::ofstream file;
+    std::string buffer;
+
+public:
+    explicit FileCombatRenderer(const std::string& path) : file(path, std::ios::app) {
+        if (!file)
+            throw std::runtime_error("Could not open combat log " + path);
+    }
+
+    void render(const CombatLog& log) override {
+        buffer.clear();
+        for (size_t i = 0; i < log.size(); ++i)
+            appendCombatEvent(buffer, log, log[i], false);
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        file.flush();
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "Random.h"
+
+/*
+ * The arithmetic of a fight, shared by Entity and the headless combat
+ * simulation (CombatSimulation.h) so balance numbers come from the rules
+ * the game actually plays by.
+ */
+
+// Percent of attacks the target dodges
+const int dodgeChance = 25;
+
+/* Entity::attack and the simulator both draw one number per attack here, so a seed replays either */
+inline bool isDodged(Random& random) { return random.chance(dodgeChance); }
+
+/* Health lost to an attack of amount; defense is subtracted and never heals */
+inline int damageAfterDefense(int amount, int defense) {
+    int damage = amount - defense;
+    return damage > 0 ? damage : 0;
+}
+
+/* Health left after losing damage, never below 0 */
+inline int healthAfterDamage(int health, int damage) { return health - damage < 0 ? 0 : health - damage; }
+
+/* One level up if experience is enough for it; call until false */
+inline bool levelUpOnce(int& level, int& experience) {
+    if (experience < (level + 1) * 100)
+        return false;
+    level++;
+    experience -= (level + 1) * 100;
+    return true;
+}
@@ -0,0 +1,360 @@
+#pragma once
+#include "CombatRules.h"
+#include "Entity.h"
+#include "EntityStore.h"
+#include "Random.h"
+#include "FightMenu.h"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/* The numbers of one side of a fight; names and loggers stay with the Entity */
+struct Combatant {
+    int health = 0;
+    int damage = 0;
+    int defense = 0;
+    int expByKill = 0;
+
+    static Combatant of(const Entity& entity) {
+        Combatant combatant;
+        combatant.health = entity.getHealth();
+        combatant.damage = entity.getDamage();
+        combatant.defense = entity.getDefense();
+        combatant.expByKill = entity.getExpByKill();
+        return combatant;
+    }
+};
+
+struct CombatSetup {
+    Combatant player;
+    int level = 0;
+    int experience = 0;
+    // Heal Potions in the inventory
+    int potions = 0;
+    std::vector<Combatant> monsters;
+    // Fights in a row per run; health, experience and potions carry over between them as in the game
+    size_t fightsPerRun = 1;
+    // A fight still going after this many turns counts as a stall
+    uint32_t maxTurns = 1000;
+    // Character::heal uses up the potion without restoring health; set this to try out one that does
+    int potionHealth = 0;
+};
+
+/* The player against the enemies of a fight about to start */
+inline CombatSetup makeCombatSetup(const Character& player, const std::vector<std::shared_ptr<Entity>>& enemies) {
+    CombatSetup setup;
+    setup.player = Combatant::of(player);
+    setup.level = player.getLevel();
+    setup.experience = player.getExperience();
+    for (auto& enemy : enemies) {
+        if (enemy->isAlive())
+            setup.monsters.push_back(Combatant::of(*enemy));
+    }
+    return setup;
+}
+
+/* What the policies see each turn */
+struct CombatState {
+    Combatant player;
+    // Health the player started the run with
+    int maxHealth = 0;
+    int level = 0;
+    int experience = 0;
+    // All experience gained this run, unlike experience which level ups spend
+    int64_t earned = 0;
+    int potions = 0;
+    // Dead monsters stay in place with 0 health, so indices are stable for a fight
+    EntityStore monsters;
+    uint32_t turn = 0;
+};
+
+/*
+ * Player policies pick the action of a turn and, for ATTACK, the index of a
+ * living monster. Monster policies answer an attack by calling strike(index)
+ * for every monster that hits back.
+ */
+
+/* Attacks the first living monster, as a player answering 1 every turn would */
+struct AttackFirstPolicy {
+    FightAction chooseAction(const CombatState&, Random&) { return FightAction::ATTACK; }
+
+    size_t chooseTarget(const CombatState& state, Random&) { return state.monsters.firstAlive(); }
+};
+
+/* Finishes off the monster closest to death first */
+struct AttackWeakestPolicy {
+    FightAction chooseAction(const CombatState&, Random&) { return FightAction::ATTACK; }
+
+    size_t chooseTarget(const CombatState& state, Random&) {
+        size_t best = state.monsters.size();
+        for (size_t i = state.monsters.firstAlive(); i < state.monsters.size(); i = state.monsters.firstAlive(i + 1)) {
+            if (best == state.monsters.size() || state.monsters.getHealth(i) < state.monsters.getHealth(best))
+                best = i;
+        }
+        return best;
+    }
+};
+
+/* Drinks a potion below threshold percent of the starting health, otherwise attacks the weakest */
+struct HealWhenLowPolicy {
+    int threshold = 30;
+    AttackWeakestPolicy attack;
+
+    FightAction chooseAction(const CombatState& state, Random& random) {
+        if (state.potions > 0 && state.player.health * 100 < state.maxHealth * threshold)
+            return FightAction::HEAL;
+        return attack.chooseAction(state, random);
+    }
+
+    size_t chooseTarget(const CombatState& state, Random& random) { return attack.chooseTarget(state, random); }
+};
+
+/* The attacked monster strikes back if it survived, as in Game::startFight */
+struct RetaliatePolicy {
+    template <typename Strike>
+    void respond(const CombatState& state, size_t attacked, Random&, Strike strike) {
+        if (state.monsters.isAlive(attacked))
+            strike(attacked);
+    }
+};
+
+/* Every living monster strikes back after each attack */
+struct PackPolicy {
+    template <typename Strike>
+    void respond(const CombatState& state, size_t, Random&, Strike strike) {
+        for (size_t i = state.monsters.firstAlive(); i < state.monsters.size(); i = state.monsters.firstAlive(i + 1))
+            strike(i);
+    }
+};
+
+enum class CombatOutcome {
+    WON,
+    LOST,
+    STALLED
+};
+
+// Fights won in more turns than this share the last bucket of turnsToWin
+const size_t combatTurnBuckets = 64;
+
+struct CombatCurvePoint {
+    // Runs that started this fight and that won it
+    uint64_t reached = 0;
+    uint64_t survived = 0;
+    // Summed over the runs that won it, after the fight
+    int64_t level = 0;
+    int64_t earned = 0;
+    int64_t health = 0;
+};
+
+struct CombatStatistics {
+    uint64_t fights = 0;
+    uint64_t wins = 0;
+    uint64_t losses = 0;
+    uint64_t stalls = 0;
+    uint64_t winTurns = 0;
+    // turnsToWin[t] fights won in t turns
+    std::vector<uint64_t> turnsToWin = std::vector<uint64_t>(combatTurnBuckets + 1, 0);
+    // Indexed by the fight's number in its run
+    std::vector<CombatCurvePoint> curve;
+
+    void merge(const CombatStatistics& other) {
+        fights += other.fights;
+        wins += other.wins;
+        losses += other.losses;
+        stalls += other.stalls;
+        winTurns += other.winTurns;
+        for (size_t i = 0; i < turnsToWin.size(); ++i)
+            turnsToWin[i] += other.turnsToWin[i];
+        if (curve.size() < other.curve.size())
+            curve.resize(other.curve.size());
+        for (size_t i = 0; i < other.curve.size(); ++i) {
+            curve[i].reached += other.curve[i].reached;
+            curve[i].survived += other.curve[i].survived;
+            curve[i].level += other.curve[i].level;
+            curve[i].earned += other.curve[i].earned;
+            curve[i].health += other.curve[i].health;
+        }
+    }
+
+    double winRate() const { return fights ? static_cast<double>(wins) / fights : 0.0; }
+    double averageTurnsToWin() const { return wins ? static_cast<double>(winTurns) / wins : 0.0; }
+
+    /* Turns within which fraction of the won fights were over */
+    size_t turnsToWinPercentile(double fraction) const {
+        if (wins == 0)
+            return 0;
+        uint64_t wanted = static_cast<uint64_t>(fraction * wins);
+        uint64_t seen = 0;
+        for (size_t turns = 0; turns < turnsToWin.size(); ++turns) {
+            seen += turnsToWin[turns];
+            if (seen > wanted)
+                return turns;
+        }
+        return combatTurnBuckets;
+    }
+};
+
+/*
+ * Fights by the rules of Entity::attack, Entity::takeDamage and
+ * Character::gainExperience with the combat log, the logging and the pause
+ * before a counterattack left out. The choices Game::startFight asks the player
+ * for come from PlayerPolicy, the monsters' answers from MonsterPolicy. A
+ * simulator keeps its buffers, so fights after the first allocate nothing.
+ */
+template <typename PlayerPolicy, typename MonsterPolicy>
+class CombatSimulator {
+private:
+    CombatSetup setup;
+    PlayerPolicy playerPolicy;
+    MonsterPolicy monsterPolicy;
+    Random random;
+    // The monsters as each fight starts
+    EntityStore monsters;
+    CombatState state;
+
+    bool isDodge() { return isDodged(random); }
+
+    CombatOutcome fight() {
+        state.monsters.restoreHealth(monsters);
+        state.turn = 0;
+
+        for (;;) {
+            if (state.monsters.livingCount() == 0)
+                return CombatOutcome::WON;
+            if (state.turn == setup.maxTurns)
+                return CombatOutcome::STALLED;
+            ++state.turn;
+
+            FightAction action = playerPolicy.chooseAction(state, random);
+            if (action == FightAction::ATTACK) {
+                size_t index = playerPolicy.chooseTarget(state, random);
+                if (index >= state.monsters.size() || !state.monsters.isAlive(index))
+                    throw std::logic_error("Combat policy chose a monster that is not alive");
+                // Entity::attack, then Character::attack
+                if (!isDodge())
+                    state.monsters.applyDamage(index, state.player.damage);
+                if (!state.monsters.isAlive(index)) {
+                    int experience = state.monsters.getExpByKill(index);
+                    state.experience += experience;
+                    state.earned += experience;
+                    while (levelUpOnce(state.level, state.experience)) {}
+                }
+                monsterPolicy.respond(state, index, random, [this](size_t attacker) {
+                    if (state.player.health > 0 && !isDodge())
+                        state.player.health = healthAfterDamage(state.player.health,
+                            damageAfterDefense(state.monsters.getDamage(attacker), state.player.defense));
+                });
+            }
+            else if (action == FightAction::HEAL) {
+                // Character::heal
+                if (state.potions > 0) {
+                    --state.potions;
+                    state.player.health += setup.potionHealth;
+                }
+            }
+
+            if (state.player.health <= 0)
+                return CombatOutcome::LOST;
+        }
+    }
+
+public:
+    CombatSimulator(const CombatSetup& setup, uint64_t seed,
+        PlayerPolicy playerPolicy = PlayerPolicy(), MonsterPolicy monsterPolicy = MonsterPolicy())
+        : setup(setup), playerPolicy(playerPolicy), monsterPolicy(monsterPolicy), random(seed) {
+        if (setup.monsters.empty())
+            throw std::invalid_argument("Combat setup has no monsters");
+        if (setup.fightsPerRun == 0)
+            throw std::invalid_argument("Combat setup has no fights per run");
+        monsters.reserve(setup.monsters.size());
+        for (size_t i = 0; i < setup.monsters.size(); ++i) {
+            const Combatant& monster = setup.monsters[i];
+            monsters.add(i, "Monster", "Monster", monster.health, monster.damage, monster.defense, monster.expByKill);
+        }
+    }
+
+    /* Plays fightsPerRun fights in a row, or until one is not won */
+    void run(CombatStatistics& stats) {
+        state.player = setup.player;
+        state.maxHealth = setup.player.health;
+        state.level = setup.level;
+        state.experience = setup.experience;
+        state.earned = 0;
+        state.potions = setup.potions;
+        if (stats.curve.size() < setup.fightsPerRun)
+            stats.curve.resize(setup.fightsPerRun);
+
+        for (size_t number = 0; number < setup.fightsPerRun; ++number) {
+            CombatOutcome outcome = fight();
+            CombatCurvePoint& point = stats.curve[number];
+            ++stats.fights;
+            ++point.reached;
+            if (outcome == CombatOutcome::LOST) {
+                ++stats.losses;
+                return;
+            }
+            if (outcome == CombatOutcome::STALLED) {
+                ++stats.stalls;
+                return;
+            }
+            ++stats.wins;
+            stats.winTurns += state.turn;
+            ++stats.turnsToWin[std::min<size_t>(state.turn, combatTurnBuckets)];
+            ++point.survived;
+            point.level += state.level;
+            point.earned += state.earned;
+            point.health += state.player.health;
+        }
+    }
+};
+
+/*
+ * Plays runs runs of setup on threads threads (0 for one per core). Every
+ * thread has its own simulator, generator and statistics, merged at the
+ * end, so the threads share nothing while they run. The same seed and
+ * thread count give the same statistics.
+ */
+template <typename PlayerPolicy, typename MonsterPolicy>
+CombatStatistics simulateCombat(const CombatSetup& setup, uint64_t runs, uint64_t seed, unsigned threads = 0,
+    PlayerPolicy playerPolicy = PlayerPolicy(), MonsterPolicy monsterPolicy = MonsterPolicy()) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threads, runs)));
+
+    std::vector<CombatStatistics> results(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    auto work = [&](unsigned worker) {
+        try {
+            CombatSimulator<PlayerPolicy, MonsterPolicy> simulator(setup, Random(seed, worker).getSeed(), playerPolicy, monsterPolicy);
+            // Counted locally; neighbouring entries of results would share cache lines
+            CombatStatistics stats;
+            uint64_t first = runs * worker / threads;
+            uint64_t last = runs * (worker + 1) / threads;
+            for (uint64_t i = first; i < last; ++i)
+                simulator.run(stats);
+            results[worker] = std::move(stats);
+        }
+        catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned worker = 1; worker < threads; ++worker)
+        workers.emplace_back(work, worker);
+    work(0);
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    for (unsigned worker = 1; worker < threads; ++worker)
+        results[0].merge(results[worker]);
+    return std::move(results[0]);
+}
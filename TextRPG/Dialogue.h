@@ -1,166 +1,275 @@
 #pragma once
 #include "Logger.h"
-#include <functional>
+#include "DialogueGraph.h"
+#include "DialogueAnalysis.h"
+#include "DialogueScript.h"
+#include "DialogueCheckpoint.h"
+#include "ChoiceLog.h"
+#include "ChoiceAction.h"
+#include "TypewriterRenderer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <memory>
 #include <thread>
 
-template <typename T>
-class Choice {
+class Game;
+
+// Choice actions get the game the dialogues are played in
+typedef ChoiceAction<Game> DialogueAction;
+
+/*
+ * Dialogue state in save files starts with the magic and version. Saves from
+ * before it hold a 2-byte choice count and one byte per choice, and load
+ * without a checkpoint.
+ */
+const char dialogueSaveMagic[4] = { 'D', 'L', 'G', 'S' };
+const uint8_t dialogueSaveVersion = 1;
+
+class DialogueSystem {
 private:
-    std::string text;
-    std::function<void(T)> action;
+    bool playing = false;
 
-public:
-    /* Constructor */
-    Choice(const std::string& text, std::function<void(T)> action)
-        : text(text), action(action) {
+    DialogueGraph graph;
+    // Shared with copies, like the choice log; graphs only ever append to it
+    std::shared_ptr<std::vector<DialogueAction>> actions;
+    DialogueId startDialogue = noDialogue;
+    DialogueId currentDialogue = noDialogue;
+    DialogueId endDialogue = noDialogue;
+
+    std::shared_ptr<std::vector<int>> choices;
+
+    // A checkpoint every checkpointInterval logged choices bounds what a restore replays; at most maxDialogueCheckpoints
+    std::vector<DialogueCheckpoint> checkpoints;
+    size_t checkpointInterval = 64;
+    // Links rewired by picked choices, with the value they had when the graph was built
+    std::vector<std::pair<DialogueId, DialogueId>> originalLinks;
+    std::vector<uint8_t> rewired;
+    DialogueId logCursor = noDialogue;
+
+    // Append-only saves: the log lives in journalPath and each save appends a frame with what changed
+    std::string journalPath;
+    // Prefix of the log that the journal already holds, and where its last frame ends
+    size_t journaledCount = 0;
+    uint64_t journalBytes = 0;
+    // First save of a session that did not load from the journal starts it over
+    bool journalFresh = true;
+
+    std::shared_ptr<Logger<DialogueSystem>> logger = std::make_shared<Logger<DialogueSystem>>();
+
+    void rewire(DialogueId id, DialogueId next) {
+        if (id >= rewired.size())
+            rewired.resize(graph.size(), 0);
+        if (!rewired[id]) {
+            rewired[id] = 1;
+            originalLinks.emplace_back(id, graph.node(id).next);
+        }
+        graph.node(id).next = next;
     }
 
-    /* Methods */
-    std::string getText() const { return text; }
-    void execute(T param) const { action(param); }
-};
+    void resetLinks() {
+        for (auto& link : originalLinks) {
+            graph.node(link.first).next = link.second;
+            rewired[link.first] = 0;
+        }
+        originalLinks.clear();
+    }
 
-class Dialogue {
-private:
-    int id;
-    std::string text;
-    int typeSpeed;
-    std::vector<std::shared_ptr<Choice<void*>>> choices;
-    std::shared_ptr<Dialogue> prevDialogue{ nullptr };
-    std::shared_ptr<Dialogue> nextDialogue{ nullptr };
-
-    std::shared_ptr<Logger<Dialogue>> logger = std::make_shared<Logger<Dialogue>>();
-public:
-    /* Constructor */
-    Dialogue(const std::string& text)
-        : id(0), text(text), typeSpeed(100) {
-        logger->debug("Dialogue<" + std::to_string(id) + "> created");
+    DialogueCheckpoint makeCheckpoint(size_t choiceCount) const {
+        DialogueCheckpoint checkpoint;
+        checkpoint.choiceCount = static_cast<uint32_t>(choiceCount);
+        checkpoint.cursor = logCursor;
+        for (auto& link : originalLinks)
+            checkpoint.links.emplace_back(link.first, graph.node(link.first).next);
+        return checkpoint;
     }
 
-    Dialogue(std::shared_ptr<Dialogue> prevDialogue, const std::string& text)
-        : text(text), prevDialogue(prevDialogue), typeSpeed(100) {
-        this->id = prevDialogue->getId() + 1;
-        logger->debug("Dialogue<" + std::to_string(id) + "> created");
+    bool isValid(const DialogueCheckpoint& checkpoint) const {
+        if (checkpoint.choiceCount > choices->size() || (checkpoint.cursor != noDialogue && !graph.contains(checkpoint.cursor)))
+            return false;
+        for (auto& link : checkpoint.links) {
+            if (!graph.contains(link.first) || (link.second != noDialogue && !graph.contains(link.second)))
+                return false;
+        }
+        return true;
     }
 
-    /* Destructor */
-    ~Dialogue() { logger->debug("Dialogue<" + std::to_string(id) + "> destroyed"); }
+    void applyCheckpoint(const DialogueCheckpoint& checkpoint) {
+        resetLinks();
+        for (auto& link : checkpoint.links)
+            rewire(link.first, link.second);
+        logCursor = checkpoint.cursor;
+    }
 
-    /* Getters */
-    int getId() const { return id; }
-    bool hasChoice() const { return choices.size() > 0; }
-    size_t choiceCount() const { return choices.size(); }
-    std::shared_ptr<Dialogue> getNextDialogue() const { return nextDialogue; }
+    /* Drops every other checkpoint but the latest; older positions stay covered, only more coarsely */
+    void thinCheckpoints() {
+        size_t kept = 0;
+        for (size_t i = 0; i < checkpoints.size(); ++i) {
+            if (i % 2 == 1 || i + 1 == checkpoints.size())
+                checkpoints[kept++] = std::move(checkpoints[i]);
+        }
+        checkpoints.resize(kept);
+    }
 
-    /* Setters */
-    void setTypeSpeed(int value) {
-        if (value <= 0)
-            throw std::invalid_argument("Type speed must be greater than 0");
-        logger->debug("Updated type speed for Dialogue<" + std::to_string(id) + ">");
-        typeSpeed = value;
+    void takeCheckpointIfDue(size_t choiceCount) {
+        if (choiceCount % checkpointInterval == 0 && (checkpoints.empty() || checkpoints.back().choiceCount < choiceCount)) {
+            checkpoints.push_back(makeCheckpoint(choiceCount));
+            if (checkpoints.size() > maxDialogueCheckpoints)
+                thinCheckpoints();
+        }
+    }
+
+    void logChoice(int choice, DialogueId next) {
+        choices->push_back(choice);
+        logCursor = next;
+        takeCheckpointIfDue(choices->size());
     }
-    void setId(int id) { this->id = id; }
-    void setNextDialogue(std::shared_ptr<Dialogue> dialogue) {
-        if (dialogue) {
-            logger->debug("Updated next dialogue for Dialogue<" + std::to_string(id) + "> to Dialogue<" + std::to_string(dialogue->getId()) + ">");
-            dialogue->setId(id + 1);
+
+    /* Re-applies logged choices [from, to) starting at logCursor; actions are not run again */
+    void replay(size_t from, size_t to) {
+        for (size_t i = from; i < to && logCursor != noDialogue; ++i) {
+            int choice = (*choices)[i];
+            if (choice >= 1 && static_cast<size_t>(choice) <= choiceCount(logCursor))
+                choose(logCursor, nullptr, false, choice);
+            logCursor = graph.node(logCursor).next;
+            takeCheckpointIfDue(i + 1);
         }
-        else {
-			logger->debug("Updated next dialogue for Dialogue<" + std::to_string(id) + "> to nullptr");
+    }
+
+    const DialogueNodeInfo& requireAnalysis(DialogueId id) const {
+        if (!graph.isAnalyzed())
+            throw std::logic_error("Dialogue graph has not been analyzed");
+        if (!graph.contains(id))
+            throw std::out_of_range("Dialogue not found");
+        return graph.info(id);
+    }
+
+    DialogueId requireDialogue(int id) {
+        if (id < 0) {
+            logger->error("Invalid id");
+            throw std::invalid_argument("Invalid id");
         }
-        nextDialogue = dialogue;
+        DialogueId dialogue = searchDialogue(static_cast<size_t>(id));
+        if (dialogue == noDialogue) {
+            logger->errorf("Dialogue<{}> not found", id);
+            throw std::invalid_argument("Dialogue<" + std::to_string(id) + "> not found");
+        }
+        return dialogue;
     }
 
-    void addChoice(const std::string& choiceText, std::function<void(void*)> action, std::shared_ptr<Dialogue> nextDialogue = nullptr) {
-        if (!action) {
-            logger->error("Invalid action function");
-            throw std::invalid_argument("Invalid action function");
+    /* Links may lead nowhere, but not to a dialogue the graph does not hold */
+    DialogueId requireTarget(DialogueId target) {
+        if (target != noDialogue && !graph.contains(target)) {
+            logger->errorf("Dialogue<{}> not found", target);
+            throw std::invalid_argument("Dialogue<" + std::to_string(target) + "> not found");
         }
-        choices.push_back(std::make_shared<Choice<void*>>(choiceText, [this, action, nextDialogue](void* param) {
-            action(param);
-            this->setNextDialogue(nextDialogue);
-            }));
-        logger->debug("Added choice with text: " + choiceText);
+        return target;
     }
 
-    void addChoice(const std::string& choiceText, std::shared_ptr<Dialogue> nextDialogue) {
-        choices.push_back(std::make_shared<Choice<void*>>(choiceText, [this, nextDialogue](void* param) {
-            this->setNextDialogue(nextDialogue);
-            }));
-        logger->debug("Added choice with text: " + choiceText);
+    void runAction(uint32_t action, Game* game) {
+        if (!(*actions)[action]) {
+            logger->errorf("Action {} is not bound", action < graph.actionTotal() ? graph.actionName(action) : std::to_string(action));
+            return;
+        }
+        (*actions)[action](game);
     }
 
-    void display(bool output = true) const {
+    /* Queues the text on the renderer and returns while it is still being typed */
+    void display(DialogueId id, bool output = true) const {
         if (!output)
             return;
-        logger->debug("Displaying Dialogue<" + std::to_string(id) + ">");
-        std::cout << "\033[34m";
-        for (auto& letter : text) {
-            std::cout << letter;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / typeSpeed));
-        }
-        std::cout << "\033[0m" << std::endl;
+        LOG_DEBUGF(*logger, "Displaying Dialogue<{}>", id);
+        const DialogueNode& node = graph.node(id);
+        TypewriterRenderer& renderer = TypewriterRenderer::instance();
+        renderer.print("\033[34m");
+        renderer.type(graph.text(node.text), std::chrono::microseconds(1000000 / node.typeSpeed));
+        renderer.print("\033[0m\n");
     }
 
-    size_t choose(void* param, bool output = true, int choice = 255) const {
+    size_t choose(DialogueId id, Game* game, bool output = true, int choice = 255) {
         if (choice == 255 && !output)
             return choice;
 
-        while (choice - 1 < 0 || choice - 1 >= choices.size())
+        const DialogueNode& node = graph.node(id);
+        TypewriterRenderer& renderer = TypewriterRenderer::instance();
+        while (choice - 1 < 0 || choice - 1 >= node.choiceCount)
         {
             if (output) {
-                display(output);
-                for (size_t i = 0; i < choices.size(); ++i)
-                {
-                    std::cout << "- " << i + 1 << "." << choices[i]->getText() << std::endl;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                display(id, output);
+                size_t number = 0;
+                for (uint32_t index = node.firstChoice; index != noChoice; index = graph.choice(index).nextChoice) {
+                    std::chrono::milliseconds pause(number > 0 ? 50 : 0);
+                    renderer.print("- " + std::to_string(++number) + "." + graph.text(graph.choice(index).text) + "\n", pause);
                 }
-                std::cout << "\033[35m[?] Enter your choice: ";
+                renderer.print("\033[35m[?] Enter your choice: ", std::chrono::milliseconds(50));
             }
+            // The player may answer before the text is done; the rest is then shown at once
             std::cin >> choice;
             std::cin.ignore();
-            if (choice - 1 < 0 || choice - 1 >= choices.size())
+            renderer.skip();
+            if (choice - 1 < 0 || choice - 1 >= node.choiceCount)
                 std::cout << "\033[31m[-] Invalid choice" << "\033[0m" << std::endl;
             else
                 break;
         }
-        choices[choice - 1]->execute(param);
-        logger->debug("Selected choice " + std::to_string(choice) + " for Dialogue<" + std::to_string(id) + ">");
+
+        const DialogueChoice& picked = graph.choice(graph.choiceAt(id, choice));
+        // Replays pass no game: what the action did (a fight, an item) is in the save already
+        if (picked.action != noAction && game)
+            runAction(picked.action, game);
+        rewire(id, picked.target);
+        LOG_DEBUGF(*logger, "Selected choice {} for Dialogue<{}>", choice, id);
         return choice;
     }
 
-    int execute(void* param, bool output = true) {
-        if (hasChoice()) {
-            int choice = choose(param, output);
-            logger->debug("Returning from Dialogue<" + std::to_string(id) + "> with choice <" + std::to_string(choice) + ">");
+    int executeDialogue(DialogueId id, Game* game, bool output = true) {
+        if (hasChoice(id)) {
+            int choice = static_cast<int>(choose(id, game, output));
+            logger->debugf("Returning from Dialogue<{}> with choice <{}>", id, choice);
             return choice;
         }
-        display(output);
-        logger->debug("Returning from Dialogue<" + std::to_string(id) + "> with no choice");
+        display(id, output);
+        logger->debugf("Returning from Dialogue<{}> with no choice", id);
         return -1;
     }
-};
-
-class DialogueSystem {
-private:
-    bool playing = false;
 
-    std::shared_ptr<std::vector<std::shared_ptr<Dialogue>>> allDialogues;
-    std::shared_ptr<Dialogue> startDialogue{ nullptr };
-    std::shared_ptr<Dialogue> currentDialogue{ nullptr };
-    std::shared_ptr<Dialogue> endDialogue{ nullptr };
+    /* Saves written before the magic: a 2-byte count and one byte per choice, replayed from the start */
+    void loadUnversioned(std::ifstream& file) {
+        uint16_t count = 0;
+        file.read(reinterpret_cast<char*>(&count), 2);
+        logger->debugf("Loading {} choices from a save without a version", count);
+        choices->clear();
+        for (uint16_t i = 0; i < count; ++i) {
+            int8_t choice = 0;
+            if (!file.read(reinterpret_cast<char*>(&choice), 1))
+                break;
+            choices->push_back(choice);
+        }
+        recover(nullptr);
+    }
 
-    std::shared_ptr<std::vector<int>> choices;
+    void recover(const DialogueCheckpoint* checkpoint) {
+        if (startDialogue != noDialogue) {
+            logger->debug("Dialog tree recovery");
+            checkpoints.clear();
+            if (checkpoint && isValid(*checkpoint))
+                checkpoints.push_back(*checkpoint);
+            restore(choices->size());
+        }
+        else {
+            logger->debug("No start dialogue found, skipping recovery dialog tree");
+            choices->clear();
+        }
+    }
 
-    std::shared_ptr<Logger<DialogueSystem>> logger = std::make_shared<Logger<DialogueSystem>>();
 public:
     DialogueSystem()
-        : choices(std::make_shared<std::vector<int>>()),
-        allDialogues(std::make_shared<std::vector<std::shared_ptr<Dialogue>>>()) {
+        : actions(std::make_shared<std::vector<DialogueAction>>()),
+        choices(std::make_shared<std::vector<int>>()) {
         logger->debug("DialogueSystem created");
     }
 
@@ -168,155 +277,389 @@ public:
         logger->debug("DialogueSystem destroyed");
     }
 
-    std::shared_ptr<Dialogue> getStartDialogue() const { return startDialogue; }
-    std::shared_ptr<Dialogue> getCurrentDialogue() const { return currentDialogue; }
-    std::shared_ptr<Dialogue> getEndDialogue() const { return endDialogue; }
+    DialogueId getStartDialogue() const { return startDialogue; }
+    DialogueId getCurrentDialogue() const { return currentDialogue; }
+    DialogueId getEndDialogue() const { return endDialogue; }
+    size_t dialogueCount() const { return graph.size(); }
+    const DialogueGraph& getGraph() const { return graph; }
+
+    bool hasChoice(DialogueId id) const { return graph.node(id).choiceCount > 0; }
+    size_t choiceCount(DialogueId id) const { return graph.node(id).choiceCount; }
+    DialogueId getNextDialogue(DialogueId id) const { return graph.node(id).next; }
+    std::string getDialogueText(DialogueId id) const { return graph.text(graph.node(id).text); }
+
+    /* Bytes held by the graph and the action table */
+    size_t getMemoryUsage() const {
+        return graph.memoryUsage() + actions->capacity() * sizeof(DialogueAction);
+    }
+
+    void setTypeSpeed(DialogueId id, int value) {
+        if (value <= 0 || value > UINT16_MAX)
+            throw std::invalid_argument("Type speed must be greater than 0");
+        logger->debugf("Updated type speed for Dialogue<{}>", id);
+        graph.node(id).typeSpeed = static_cast<uint16_t>(value);
+    }
 
-    void createNewDialogue(std::string text) {
-        std::shared_ptr<Dialogue> dialogue = std::make_shared<Dialogue>(text);
-        if (!startDialogue) {
+    DialogueId createNewDialogue(std::string text) {
+        DialogueId dialogue = graph.addNode(text, 100);
+        if (startDialogue == noDialogue) {
             logger->debug("Selecting Dialogue<0> as start dialogue");
             startDialogue = dialogue;
             currentDialogue = dialogue;
-            endDialogue = dialogue;
         }
         else {
-            logger->debug("Selecting Dialogue<" + std::to_string(endDialogue->getId() + 1) + "> as end dialogue");
-            dialogue->setId(endDialogue->getId() + 1);
-            endDialogue->setNextDialogue(dialogue);
-            endDialogue = endDialogue->getNextDialogue();
+            logger->debugf("Selecting Dialogue<{}> as end dialogue", dialogue);
+            graph.node(endDialogue).next = dialogue;
         }
-		allDialogues->push_back(dialogue);
+        endDialogue = dialogue;
+        return dialogue;
     }
 
-    void setNextDialogue(std::shared_ptr<Dialogue> dialogue, std::shared_ptr<Dialogue> nextDialogue)
+    void setNextDialogue(DialogueId dialogue, DialogueId nextDialogue)
     {
-        dialogue->setNextDialogue(nextDialogue);
+        if (!graph.contains(dialogue)) {
+            logger->errorf("Dialogue<{}> not found", dialogue);
+            throw std::invalid_argument("Dialogue<" + std::to_string(dialogue) + "> not found");
+        }
+        requireTarget(nextDialogue);
+        if (nextDialogue != noDialogue)
+            logger->debugf("Updated next dialogue for Dialogue<{}> to Dialogue<{}>", dialogue, nextDialogue);
+        else
+            logger->debugf("Updated next dialogue for Dialogue<{}> to nullptr", dialogue);
+        graph.node(dialogue).next = nextDialogue;
+        graph.clearAnalysis();
     }
 
-    std::shared_ptr<Dialogue> searchDialogue(size_t id) {
-        logger->debug("Searching Dialogue<" + std::to_string(id) + ">");
-        std::shared_ptr<Dialogue> dialogue = startDialogue;
-        for (auto& dialogue : *allDialogues)
-        {
-            if (dialogue->getId() == id) {
-                logger->debug("Dialogue<" + std::to_string(id) + "> found");
-                return dialogue;
-            }
+    DialogueId searchDialogue(size_t id) const {
+        LOG_DEBUGF(*logger, "Searching Dialogue<{}>", id);
+        if (id < graph.size()) {
+            LOG_DEBUGF(*logger, "Dialogue<{}> found", id);
+            return static_cast<DialogueId>(id);
         }
-        logger->debug("Dialogue<" + std::to_string(id) + "> not found");
-        return nullptr;
+        LOG_DEBUGF(*logger, "Dialogue<{}> not found", id);
+        return noDialogue;
     }
 
-    void addChoiceToDialogue(std::string text, std::shared_ptr<Dialogue> nextDialogue, int id = -1) {
-        if (!startDialogue) {
+    void addChoiceToDialogue(std::string text, DialogueId nextDialogue, int id = -1) {
+        if (startDialogue == noDialogue) {
             logger->error("No dialogue created");
             return;
         }
-        else if (id == -1) {
-            logger->debug("Adding choice to end of Dialogue<" + std::to_string(endDialogue->getId()) + ">");
-            endDialogue->addChoice(text, nextDialogue);
-        }
-        else if (id < 0) {
-            logger->error("Invalid id");
-            throw std::invalid_argument("Invalid id");
-        }
-
-        std::shared_ptr<Dialogue> dialogue = searchDialogue(id);
-        if (!dialogue) {
-            logger->error("Dialogue<" + std::to_string(id) + "> not found");
-            throw std::invalid_argument("Dialogue<" + std::to_string(id) + "> not found");
-        }
 
-        logger->debug("Adding choice to Dialogue<" + std::to_string(dialogue->getId()) + ">");
-        dialogue->addChoice(text, nextDialogue);
+        DialogueId dialogue = id == -1 ? endDialogue : requireDialogue(id);
+        logger->debugf("Adding choice to Dialogue<{}>", dialogue);
+        graph.addChoice(dialogue, text, requireTarget(nextDialogue), noAction);
     }
 
-    void addChoiceToDialogue(std::string text, std::function<void(void*)> action, std::shared_ptr<Dialogue> nextDialogue, int id = -1) {
-        if (!startDialogue.get()) {
+    void addChoiceToDialogue(std::string text, DialogueAction action, DialogueId nextDialogue, int id = -1) {
+        if (startDialogue == noDialogue) {
             logger->error("No dialogue created");
             return;
         }
+        if (!action) {
+            logger->error("Invalid action function");
+            throw std::invalid_argument("Invalid action function");
+        }
 
-        if (id == -1) {
-            logger->debug("Adding choice to end of Dialogue<" + std::to_string(endDialogue->getId()) + ">");
-            endDialogue->addChoice(text, action);
-            return;
+        DialogueId dialogue = id == -1 ? endDialogue : requireDialogue(id);
+        requireTarget(nextDialogue);
+        logger->debugf("Adding choice to Dialogue<{}>", dialogue);
+        actions->push_back(std::move(action));
+        graph.addChoice(dialogue, text, nextDialogue, static_cast<uint32_t>(actions->size() - 1));
+    }
+
+    /*
+     * Replaces the dialogues with a compiled image (see DialogueCompiler.h).
+     * The image is mapped and used in place, so nothing is built or allocated
+     * per dialogue; actions named in the script are attached with bindAction.
+     */
+    void loadImage(const std::string& path) {
+        DialogueImageHeader header = graph.attachImage(std::make_shared<MappedFile>(path));
+        actions = std::make_shared<std::vector<DialogueAction>>(header.actionCount);
+        startDialogue = header.start;
+        currentDialogue = header.start;
+        endDialogue = header.end;
+        choices->clear();
+        checkpoints.clear();
+        originalLinks.clear();
+        rewired.clear();
+        logCursor = startDialogue;
+        logger->debugf("Mapped {} dialogues and {} choices from {}", header.nodeCount, header.choiceCount, path);
+    }
+
+    void bindAction(const std::string& name, DialogueAction action) {
+        uint32_t index = graph.findAction(name);
+        if (index == noAction) {
+            logger->errorf("No choice uses action {}", name);
+            throw std::invalid_argument("No choice uses action " + name);
         }
-        else if (id < 0) {
-            logger->error("Invalid id");
-            throw std::invalid_argument("Invalid id");
+        if (!action) {
+            logger->error("Invalid action function");
+            throw std::invalid_argument("Invalid action function");
         }
+        (*actions)[index] = std::move(action);
+    }
 
-        std::shared_ptr<Dialogue> dialogue = searchDialogue(id);
-        if (!dialogue) {
-            logger->error("Dialogue<" + std::to_string(id) + "> not found");
-            throw std::invalid_argument("Dialogue<" + std::to_string(id) + "> not found");
+    /*
+     * Checks the graph and keeps what it found (see DialogueAnalysis.h) so
+     * dialoguesToEnd, shortestChoice and getProgress are single lookups.
+     * Throws if the graph cannot be played to its end. Adding dialogues or
+     * choices or changing a next dialogue drops the results again; compiled
+     * images carry them already.
+     */
+    DialogueAnalysis analyze() {
+        DialogueAnalysis analysis = analyzeDialogues(graph, startDialogue);
+        for (auto& warning : analysis.warnings)
+            logger->warning(warning.message);
+        if (!analysis.ok()) {
+            for (auto& error : analysis.errors)
+                logger->error(error.message);
+            throw std::runtime_error("Dialogue graph is broken: " + analysis.errors.front().message);
         }
+        logger->debugf("Analyzed {} dialogues: {} reachable, {} loops", graph.size(), analysis.reachableCount, analysis.cycleCount);
+        graph.setAnalysis(analysis.infos);
+        return analysis;
+    }
+
+    bool isAnalyzed() const { return graph.isAnalyzed(); }
+
+    /* Dialogues left to show from id on the shortest way to the end, including id itself */
+    uint32_t dialoguesToEnd(DialogueId id) const { return requireAnalysis(id).distanceToEnd; }
+
+    /* Choice number to pick at id to end the story soonest, 0 if id has no choices */
+    int shortestChoice(DialogueId id) const { return static_cast<int>(requireAnalysis(id).bestChoice); }
 
-        logger->debug("Adding choice to Dialogue<" + std::to_string(dialogue->getId()) + ">");
-        dialogue->addChoice(text, action, nextDialogue);
+    /* How far the current dialogue is along the shortest way from start to end, from 0 to 100 */
+    int getProgress() const {
+        if (currentDialogue == noDialogue)
+            return 100;
+        uint32_t total = requireAnalysis(startDialogue).distanceToEnd;
+        uint32_t left = requireAnalysis(currentDialogue).distanceToEnd;
+        // Wandering back past the start does not make progress negative
+        if (left >= total)
+            return 0;
+        return static_cast<int>(100 * static_cast<uint64_t>(total - left) / total);
     }
 
     void stop() { playing = false; }
 
-    void execute(void* param) {
+    void execute(Game* game) {
         playing = true;
-        while (currentDialogue && playing) {
-            logger->debug("Executing Dialogue<" + std::to_string(currentDialogue->getId()) + ">");
-            int choice = currentDialogue->execute(param);
-            choices->push_back(choice);
-
-            if (currentDialogue->getNextDialogue()) {
-                logger->debug("Selected next Dialogue<" + std::to_string(currentDialogue->getNextDialogue()->getId()) + ">");
-                currentDialogue = currentDialogue->getNextDialogue();
+        while (currentDialogue != noDialogue && playing) {
+            logger->debugf("Executing Dialogue<{}>", currentDialogue);
+            int choice = executeDialogue(currentDialogue, game);
+            DialogueId next = graph.node(currentDialogue).next;
+            logChoice(choice, next);
+
+            if (next != noDialogue) {
+                logger->debugf("Selected next Dialogue<{}>", next);
+                currentDialogue = next;
             }
             else {
                 logger->debug("No next dialogue found, ending dialogue sequence");
                 break;
             }
 
-            logger->debug("Dialogue<" + std::to_string(currentDialogue->getId()) + "> finished");
+            logger->debugf("Dialogue<{}> finished", currentDialogue);
         }
+        // Whatever runs next writes to std::cout directly
+        TypewriterRenderer::instance().finish();
         logger->debug("DialogueSystem finished");
     }
 
+    /*
+     * Plays the graph from the start dialogue at machine speed: no output, no
+     * typewriter delay, answers taken from script. Unlike execute, the graph
+     * is left untouched, so the same system can be replayed any number of
+     * times; run keeps its capacity between calls.
+     */
+    void runHeadless(DialogueScript& script, DialogueRun& run, const HeadlessOptions& options = HeadlessOptions()) {
+        // Actions are handed the game, as in a played dialogue
+        if (options.runActions && !options.game)
+            throw std::invalid_argument("Running actions needs a game");
+        run.clear();
+        DialogueId dialogue = startDialogue;
+        while (dialogue != noDialogue && run.path.size() < options.maxSteps) {
+            const DialogueNode& node = graph.node(dialogue);
+            run.path.push_back(dialogue);
+
+            DialogueId next = node.next;
+            if (node.choiceCount == 0) {
+                run.choices.push_back(-1);
+            }
+            else {
+                int choice = 0;
+                uint32_t index = noChoice;
+                // An invalid answer is skipped, just as the prompt asks again
+                while (index == noChoice) {
+                    if (!script.next(choice)) {
+                        LOG_DEBUGF(*logger, "Headless run ran out of input at Dialogue<{}>", dialogue);
+                        return;
+                    }
+                    index = choice > 0 ? graph.choiceAt(dialogue, static_cast<size_t>(choice)) : noChoice;
+                }
+
+                const DialogueChoice& picked = graph.choice(index);
+                if (options.runActions && picked.action != noAction)
+                    runAction(picked.action, options.game);
+                run.choices.push_back(choice);
+                next = picked.target;
+            }
+
+            if (next == noDialogue) {
+                run.completed = true;
+                break;
+            }
+            dialogue = next;
+        }
+        LOG_DEBUGF(*logger, "Headless run visited {} dialogues", run.path.size());
+    }
+
+    DialogueRun runHeadless(DialogueScript& script, const HeadlessOptions& options = HeadlessOptions()) {
+        DialogueRun run;
+        runHeadless(script, run, options);
+        return run;
+    }
+
+    void setCheckpointInterval(size_t value) {
+        if (value == 0)
+            throw std::invalid_argument("Checkpoint interval must be greater than 0");
+        checkpointInterval = value;
+    }
+
+    /*
+     * Rewinds (or replays) to the state after the first count logged choices
+     * and drops the rest of the log. Only the choices after the nearest
+     * checkpoint are replayed, so the cost does not grow with the history.
+     */
+    void restore(size_t count) {
+        count = std::min(count, choices->size());
+        size_t from = 0;
+        while (!checkpoints.empty() && checkpoints.back().choiceCount > count)
+            checkpoints.pop_back();
+        if (!checkpoints.empty()) {
+            applyCheckpoint(checkpoints.back());
+            from = checkpoints.back().choiceCount;
+        }
+        else {
+            resetLinks();
+            logCursor = startDialogue;
+        }
+        logger->debugf("Restoring {} choices, replaying {}", count, count - from);
+        replay(from, count);
+        choices->resize(count);
+        journaledCount = std::min(journaledCount, count);
+        currentDialogue = logCursor;
+    }
+
+    /* Replays a whole choice log from the start dialogue */
     void fastTravel(std::shared_ptr<std::vector<int>> choices) {
-        currentDialogue = startDialogue;
-		for (auto& choice : *choices) {
-            if (currentDialogue->hasChoice() && choice != 255)
-                currentDialogue->choose(nullptr, false, choice);
-            currentDialogue = currentDialogue->getNextDialogue();
-		}
+        if (choices != this->choices)
+            *this->choices = *choices;
+        checkpoints.clear();
+        journaledCount = 0;
+        restore(this->choices->size());
+    }
+
+    /* Choices are appended to path on save instead of being written into the save file */
+    void setChoiceJournal(const std::string& path) {
+        journalPath = path;
+        journaledCount = 0;
+        journalBytes = 0;
+        journalFresh = true;
     }
 
+    const std::string& getChoiceJournal() const { return journalPath; }
+
     void save(std::ofstream& file) {
-        size_t size = choices->size();
-        file.write(reinterpret_cast<const char*>(&size), 2);
-        logger->debug("Saving " + std::to_string(choices->size()) + " choices");
-        for (auto& choice : *choices) {
-            file.write(reinterpret_cast<const char*>(&choice), 1);
+        file.write(dialogueSaveMagic, sizeof(dialogueSaveMagic));
+        file.put(static_cast<char>(dialogueSaveVersion));
+        uint8_t journaled = journalPath.empty() ? 0 : 1;
+        file.write(reinterpret_cast<const char*>(&journaled), 1);
+        if (!journaled) {
+            logger->debugf("Saving {} choices", choices->size());
+            writeChoiceFrame(file, *choices, 0);
+        }
+        else {
+            size_t from = journalFresh ? 0 : std::min(journaledCount, choices->size());
+            // Overwrites whatever an interrupted save may have left after the last complete frame
+            std::ofstream journal;
+            if (!journalFresh)
+                journal.open(journalPath, std::ios::binary | std::ios::in | std::ios::out);
+            if (journal.is_open()) {
+                journal.seekp(static_cast<std::streamoff>(journalBytes));
+            }
+            else {
+                journal.open(journalPath, std::ios::binary | std::ios::trunc);
+                from = 0;
+                journalBytes = 0;
+            }
+            if (!journal)
+                throw std::runtime_error("Could not open choice journal " + journalPath);
+            logger->debugf("Appending choices {}..{} to {}", from, choices->size(), journalPath);
+            journalBytes += writeChoiceFrame(journal, *choices, from);
+            journaledCount = choices->size();
+            journalFresh = false;
+
+            std::string reference;
+            appendVarint(reference, journalPath.size());
+            reference += journalPath;
+            appendVarint(reference, choices->size());
+            appendVarint(reference, journalBytes);
+            file.write(reference.data(), reference.size());
         }
+        // The exact current state, so loading has nothing to replay
+        makeCheckpoint(choices->size()).save(file);
     }
 
     void load(std::ifstream& file) {
-        size_t size = 0;
-        file.read(reinterpret_cast<char*>(&size), 2);
-        logger->debug("Loading " + std::to_string(size) + " choices");
-        choices->clear();
-        for (size_t i = 0; i < size; ++i) {
-            int choice = 0;
-            file.read(reinterpret_cast<char*>(&choice), 1);
-            choices->push_back(choice);
+        std::streampos start = file.tellg();
+        char magic[sizeof(dialogueSaveMagic)] = {};
+        bool current = file.read(magic, sizeof(magic)) && std::memcmp(magic, dialogueSaveMagic, sizeof(magic)) == 0;
+        if (!current) {
+            file.clear();
+            file.seekg(start);
+            loadUnversioned(file);
+            return;
         }
+        int version = file.get();
+        if (version != dialogueSaveVersion)
+            throw std::runtime_error("Unsupported dialogue save version " + std::to_string(version));
 
-        if (startDialogue) {
-            logger->debug("Dialog tree recovery");
-            fastTravel(choices);
+        uint8_t journaled = 0;
+        file.read(reinterpret_cast<char*>(&journaled), 1);
+        choices->clear();
+        if (!journaled) {
+            if (!readChoiceFrame(file, *choices))
+                logger->error("Choice log in the save file is damaged");
+            logger->debugf("Loaded {} choices", choices->size());
         }
         else {
-            logger->debug("No start dialogue found, skipping recovery dialog tree");
-			choices->clear();
+            uint64_t pathSize = 0, count = 0, end = 0;
+            readVarint(file, pathSize);
+            std::string path(static_cast<size_t>(std::min<uint64_t>(pathSize, 4096)), '\0');
+            file.read(&path[0], path.size());
+            readVarint(file, count);
+            readVarint(file, end);
+
+            // Frames past end were appended by a save that did not complete
+            std::ifstream journal(path, std::ios::binary);
+            while (journal && static_cast<uint64_t>(journal.tellg()) < end) {
+                if (!readChoiceFrame(journal, *choices))
+                    break;
+            }
+            if (choices->size() != count)
+                logger->errorf("Choice journal {} holds {} of {} choices", path, choices->size(), count);
+            choices->resize(std::min<size_t>(choices->size(), static_cast<size_t>(count)));
+            logger->debugf("Loaded {} choices from {}", choices->size(), path);
+
+            journalPath = path;
+            journaledCount = choices->size();
+            journalBytes = end;
+            journalFresh = false;
         }
+        DialogueCheckpoint checkpoint;
+        bool hasCheckpoint = checkpoint.load(file);
+        recover(hasCheckpoint ? &checkpoint : nullptr);
     }
-};
\ No newline at end of file
+};
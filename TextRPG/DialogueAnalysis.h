@@ -0,0 +1,286 @@
+#pragma once
+#include "DialogueGraph.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Problems of one kind past this many are only counted
+const size_t maxDialogueIssues = 16;
+
+struct DialogueIssue {
+    DialogueId dialogue;
+    std::string message;
+};
+
+/*
+ * What analyzeDialogues found. Errors make a graph unplayable (a link to a
+ * dialogue that does not exist, a loop the story can never leave); warnings
+ * are dialogues nothing leads to.
+ */
+struct DialogueAnalysis {
+    std::vector<DialogueNodeInfo> infos;
+    std::vector<DialogueIssue> errors;
+    std::vector<DialogueIssue> warnings;
+    size_t reachableCount = 0;
+    size_t componentCount = 0;
+    // Components a player can go round in: more than one dialogue, or one that leads to itself
+    size_t cycleCount = 0;
+
+    bool ok() const { return errors.empty(); }
+};
+
+/*
+ * The graph as played: a dialogue with choices goes wherever the picked
+ * choice leads (choosing rewires next), one without choices goes to next.
+ * Edges to noDialogue end the story and are not stored. Kept in CSR form so
+ * a graph of a million dialogues is a handful of flat arrays.
+ */
+class DialogueEdges {
+private:
+    std::vector<uint32_t> forwardStart;
+    std::vector<DialogueId> forward;
+    std::vector<uint32_t> reverseStart;
+    // Source dialogue and the choice number that leads from it, 0 for next
+    std::vector<std::pair<DialogueId, uint32_t>> reverse;
+    std::vector<uint8_t> ends;
+
+    template <typename Visit>
+    static void forEachTarget(const DialogueGraph& graph, DialogueId id, Visit visit) {
+        const DialogueNode& node = graph.node(id);
+        if (node.choiceCount == 0) {
+            visit(node.next, 0u);
+            return;
+        }
+        uint32_t number = 0;
+        for (uint32_t index = node.firstChoice; index != noChoice; index = graph.choice(index).nextChoice)
+            visit(graph.choice(index).target, ++number);
+    }
+
+public:
+    /* Dangling links are reported to dangling and left out */
+    template <typename Report>
+    DialogueEdges(const DialogueGraph& graph, Report dangling) {
+        size_t count = graph.size();
+        forwardStart.assign(count + 1, 0);
+        reverseStart.assign(count + 1, 0);
+        ends.assign(count, 0);
+        for (DialogueId id = 0; id < count; ++id) {
+            forEachTarget(graph, id, [&](DialogueId target, uint32_t number) {
+                if (target == noDialogue)
+                    ends[id] = 1;
+                else if (!graph.contains(target))
+                    dangling(id, target, number);
+                else {
+                    ++forwardStart[id + 1];
+                    ++reverseStart[target + 1];
+                }
+            });
+        }
+        for (size_t i = 0; i < count; ++i) {
+            forwardStart[i + 1] += forwardStart[i];
+            reverseStart[i + 1] += reverseStart[i];
+        }
+
+        forward.resize(forwardStart[count]);
+        reverse.resize(reverseStart[count]);
+        std::vector<uint32_t> reverseFill(reverseStart.begin(), reverseStart.end() - 1);
+        for (DialogueId id = 0; id < count; ++id) {
+            uint32_t fill = forwardStart[id];
+            forEachTarget(graph, id, [&](DialogueId target, uint32_t number) {
+                if (target != noDialogue && graph.contains(target)) {
+                    forward[fill++] = target;
+                    reverse[reverseFill[target]++] = std::make_pair(id, number);
+                }
+            });
+        }
+    }
+
+    size_t size() const { return ends.size(); }
+    bool endsStory(DialogueId id) const { return ends[id] != 0; }
+
+    const DialogueId* successorsBegin(DialogueId id) const { return forward.data() + forwardStart[id]; }
+    const DialogueId* successorsEnd(DialogueId id) const { return forward.data() + forwardStart[id + 1]; }
+    const std::pair<DialogueId, uint32_t>* predecessorsBegin(DialogueId id) const { return reverse.data() + reverseStart[id]; }
+    const std::pair<DialogueId, uint32_t>* predecessorsEnd(DialogueId id) const { return reverse.data() + reverseStart[id + 1]; }
+};
+
+namespace dialogue_analysis {
+
+inline void report(std::vector<DialogueIssue>& issues, size_t& dropped, DialogueId dialogue, std::string message) {
+    if (issues.size() < maxDialogueIssues)
+        issues.push_back(DialogueIssue{ dialogue, std::move(message) });
+    else
+        ++dropped;
+}
+
+inline void summarizeDropped(std::vector<DialogueIssue>& issues, size_t dropped, const char* what) {
+    if (dropped > 0)
+        issues.push_back(DialogueIssue{ noDialogue, "and " + std::to_string(dropped) + " more " + what });
+}
+
+/* Tarjan's algorithm with an explicit stack, so long chains of dialogues cannot overflow the call stack */
+inline size_t findComponents(const DialogueEdges& edges, std::vector<DialogueNodeInfo>& infos, size_t& cycleCount) {
+    const uint32_t unvisited = static_cast<uint32_t>(-1);
+    size_t count = edges.size();
+    std::vector<uint32_t> order(count, unvisited);
+    std::vector<uint32_t> low(count, 0);
+    std::vector<uint8_t> onStack(count, 0);
+    std::vector<DialogueId> stack;
+    // Dialogue being explored and how many of its successors are done
+    std::vector<std::pair<DialogueId, uint32_t>> frames;
+    uint32_t nextOrder = 0;
+    size_t components = 0;
+
+    for (DialogueId root = 0; root < count; ++root) {
+        if (order[root] != unvisited)
+            continue;
+        frames.emplace_back(root, 0);
+        while (!frames.empty()) {
+            DialogueId id = frames.back().first;
+            uint32_t& done = frames.back().second;
+            if (done == 0 && order[id] == unvisited) {
+                order[id] = low[id] = nextOrder++;
+                stack.push_back(id);
+                onStack[id] = 1;
+            }
+
+            const DialogueId* successors = edges.successorsBegin(id);
+            size_t successorCount = edges.successorsEnd(id) - successors;
+            if (done < successorCount) {
+                DialogueId target = successors[done++];
+                if (order[target] == unvisited)
+                    frames.emplace_back(target, 0);
+                else if (onStack[target])
+                    low[id] = std::min(low[id], order[target]);
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty()) {
+                DialogueId parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[id]);
+            }
+            if (low[id] != order[id])
+                continue;
+
+            size_t members = 0;
+            bool selfLoop = std::find(successors, successors + successorCount, id) != successors + successorCount;
+            DialogueId member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = 0;
+                infos[member].component = static_cast<uint32_t>(components);
+                ++members;
+            } while (member != id);
+            if (members > 1 || selfLoop)
+                ++cycleCount;
+            ++components;
+        }
+    }
+    return components;
+}
+
+}
+
+/*
+ * Checks the graph played from start and works out, for every dialogue,
+ * whether it can be reached, which loop it belongs to and the shortest way
+ * to the end of the story. Linear in dialogues plus choices; the results go
+ * to DialogueGraph::setAnalysis so later questions are single lookups.
+ */
+inline DialogueAnalysis analyzeDialogues(const DialogueGraph& graph, DialogueId start) {
+    using namespace dialogue_analysis;
+    DialogueAnalysis result;
+    size_t count = graph.size();
+    result.infos.assign(count, DialogueNodeInfo{ 0, noDistance, 0, 0 });
+    size_t droppedErrors = 0;
+    size_t droppedWarnings = 0;
+
+    DialogueEdges edges(graph, [&](DialogueId id, DialogueId target, uint32_t number) {
+        std::string link = number == 0 ? std::string("next dialogue") : "choice " + std::to_string(number);
+        report(result.errors, droppedErrors, id, "Dialogue<" + std::to_string(id) + "> " + link
+            + " leads to missing Dialogue<" + std::to_string(target) + ">");
+    });
+    if (count == 0)
+        return result;
+    if (!graph.contains(start)) {
+        report(result.errors, droppedErrors, start, "Start dialogue is missing");
+        summarizeDropped(result.errors, droppedErrors, "errors");
+        return result;
+    }
+
+    std::vector<DialogueId> queue;
+    queue.reserve(count);
+    queue.push_back(start);
+    result.infos[start].reachable = 1;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        for (const DialogueId* target = edges.successorsBegin(queue[head]); target != edges.successorsEnd(queue[head]); ++target) {
+            if (!result.infos[*target].reachable) {
+                result.infos[*target].reachable = 1;
+                queue.push_back(*target);
+            }
+        }
+    }
+    result.reachableCount = queue.size();
+
+    result.componentCount = findComponents(edges, result.infos, result.cycleCount);
+
+    // Backwards from the dialogues that end the story; the first visit is the shortest way
+    queue.clear();
+    for (DialogueId id = 0; id < count; ++id) {
+        if (edges.endsStory(id)) {
+            DialogueNodeInfo& info = result.infos[id];
+            info.distanceToEnd = 1;
+            // A dialogue with choices ends the story through one of them
+            if (graph.node(id).choiceCount > 0) {
+                uint32_t number = 0;
+                for (uint32_t index = graph.node(id).firstChoice; index != noChoice; index = graph.choice(index).nextChoice) {
+                    ++number;
+                    if (graph.choice(index).target == noDialogue) {
+                        info.bestChoice = number;
+                        break;
+                    }
+                }
+            }
+            queue.push_back(id);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        DialogueId id = queue[head];
+        for (auto edge = edges.predecessorsBegin(id); edge != edges.predecessorsEnd(id); ++edge) {
+            DialogueNodeInfo& info = result.infos[edge->first];
+            if (info.distanceToEnd == noDistance) {
+                info.distanceToEnd = result.infos[id].distanceToEnd + 1;
+                info.bestChoice = edge->second;
+                queue.push_back(edge->first);
+            }
+        }
+    }
+
+    // Every dialogue of a component shares its fate, so one report per trapped loop
+    std::vector<uint8_t> reported(result.componentCount, 0);
+    size_t unreachable = 0;
+    DialogueId firstUnreachable = noDialogue;
+    for (DialogueId id = 0; id < count; ++id) {
+        const DialogueNodeInfo& info = result.infos[id];
+        if (!info.reachable) {
+            if (unreachable++ == 0)
+                firstUnreachable = id;
+            continue;
+        }
+        if (info.distanceToEnd == noDistance && !reported[info.component]) {
+            reported[info.component] = 1;
+            report(result.errors, droppedErrors, id, "Dialogue<" + std::to_string(id) + "> can be reached but the story never ends from it");
+        }
+    }
+    if (unreachable > 0)
+        report(result.warnings, droppedWarnings, firstUnreachable, std::to_string(unreachable)
+            + " dialogues can never be reached, the first is Dialogue<" + std::to_string(firstUnreachable) + ">");
+    summarizeDropped(result.errors, droppedErrors, "errors");
+    summarizeDropped(result.warnings, droppedWarnings, "warnings");
+    return result;
+}
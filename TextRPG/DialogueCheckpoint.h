@@ -0,0 +1,49 @@
+#pragma once
+#include "DialogueGraph.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+// Checkpoints a DialogueSystem keeps however long the session runs
+const size_t maxDialogueCheckpoints = 16;
+
+/*
+ * Dialogue progress after a number of logged choices. Picking a choice only
+ * ever rewires a dialogue's next link, so the cursor plus the links that
+ * differ from the built graph is the whole state; its size is bounded by the
+ * graph, not by how long the session has been running.
+ */
+struct DialogueCheckpoint {
+    uint32_t choiceCount = 0;
+    // Dialogue the next logged choice belongs to
+    DialogueId cursor = noDialogue;
+    std::vector<std::pair<DialogueId, DialogueId>> links;
+
+    void save(std::ofstream& file) const {
+        uint32_t linkCount = static_cast<uint32_t>(links.size());
+        file.write(reinterpret_cast<const char*>(&choiceCount), 4);
+        file.write(reinterpret_cast<const char*>(&cursor), 4);
+        file.write(reinterpret_cast<const char*>(&linkCount), 4);
+        for (auto& link : links) {
+            file.write(reinterpret_cast<const char*>(&link.first), 4);
+            file.write(reinterpret_cast<const char*>(&link.second), 4);
+        }
+    }
+
+    bool load(std::ifstream& file) {
+        uint32_t linkCount = 0;
+        file.read(reinterpret_cast<char*>(&choiceCount), 4);
+        file.read(reinterpret_cast<char*>(&cursor), 4);
+        file.read(reinterpret_cast<char*>(&linkCount), 4);
+        links.clear();
+        for (uint32_t i = 0; i < linkCount && file; ++i) {
+            std::pair<DialogueId, DialogueId> link;
+            file.read(reinterpret_cast<char*>(&link.first), 4);
+            file.read(reinterpret_cast<char*>(&link.second), 4);
+            links.push_back(link);
+        }
+        return static_cast<bool>(file);
+    }
+};
@@ -0,0 +1,239 @@
+#pragma once
+#include "DialogueGraph.h"
+#include "DialogueAnalysis.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Compiles a dialogue script into an image that DialogueSystem::loadImage
+ * maps. Scripts are line based; blank lines and lines starting with # are
+ * skipped:
+ *
+ *   dialogue ghost                  starts a dialogue labelled ghost
+ *   text A ghostly figure appears.  a line of text, repeat for more lines
+ *   speed 60                        characters per second, 100 by default
+ *   next rest                       the dialogue that follows: the next one in the file by default, none to stop
+ *   choice rest Fight the ghost     a choice leading to rest (or none)
+ *   choice rest @flee Run away      the same, running the action bound as flee
+ *
+ * Labels may be used before their dialogue. The first dialogue starts the
+ * story and the last one ends it, as with createNewDialogue. Scripts whose
+ * story can get stuck in a loop are rejected; the analysis of the rest is
+ * stored in the image.
+ */
+struct CompiledDialogues {
+    DialogueGraph graph;
+    DialogueId start = noDialogue;
+    DialogueId end = noDialogue;
+    // Dialogues nothing leads to, and the like; they do not stop the script from compiling
+    std::vector<std::string> warnings;
+};
+
+class DialogueCompiler {
+private:
+    struct PendingChoice {
+        std::string target;
+        std::string action;
+        std::string text;
+        size_t line;
+    };
+
+    struct PendingDialogue {
+        std::string label;
+        std::string text;
+        uint16_t typeSpeed = 100;
+        std::string next;
+        bool hasNext = false;
+        size_t line = 0;
+        std::vector<PendingChoice> choices;
+    };
+
+    std::string name;
+    std::vector<PendingDialogue> dialogues;
+    std::unordered_map<std::string, DialogueId> labels;
+
+    std::runtime_error error(size_t line, const std::string& message) const {
+        return std::runtime_error(name + ":" + std::to_string(line) + ": " + message);
+    }
+
+    /* Splits off the first word of rest */
+    static std::string takeWord(std::string& rest) {
+        size_t begin = rest.find_first_not_of(" \t");
+        if (begin == std::string::npos) {
+            rest.clear();
+            return std::string();
+        }
+        size_t end = rest.find_first_of(" \t", begin);
+        std::string word = rest.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        size_t next = end == std::string::npos ? std::string::npos : rest.find_first_not_of(" \t", end);
+        rest = next == std::string::npos ? std::string() : rest.substr(next);
+        return word;
+    }
+
+    DialogueId resolve(const std::string& label, size_t line) const {
+        if (label == "none")
+            return noDialogue;
+        auto found = labels.find(label);
+        if (found == labels.end())
+            throw error(line, "unknown dialogue '" + label + "'");
+        return found->second;
+    }
+
+    void parseLine(std::string rest, size_t line) {
+        std::string keyword = takeWord(rest);
+        if (keyword.empty() || keyword[0] == '#')
+            return;
+
+        if (keyword == "dialogue") {
+            PendingDialogue dialogue;
+            dialogue.label = takeWord(rest);
+            dialogue.line = line;
+            if (dialogue.label.empty() || !rest.empty())
+                throw error(line, "expected 'dialogue <label>'");
+            if (dialogue.label == "none")
+                throw error(line, "'none' cannot be used as a label");
+            if (!labels.emplace(dialogue.label, static_cast<DialogueId>(dialogues.size())).second)
+                throw error(line, "dialogue '" + dialogue.label + "' is defined twice");
+            dialogues.push_back(std::move(dialogue));
+            return;
+        }
+        if (dialogues.empty())
+            throw error(line, "'" + keyword + "' outside of a dialogue");
+
+        PendingDialogue& dialogue = dialogues.back();
+        if (keyword == "text") {
+            if (!dialogue.text.empty())
+                dialogue.text += '\n';
+            dialogue.text += rest;
+        }
+        else if (keyword == "speed") {
+            long speed = std::strtol(rest.c_str(), nullptr, 10);
+            if (speed <= 0 || speed > UINT16_MAX)
+                throw error(line, "speed must be between 1 and " + std::to_string(UINT16_MAX));
+            dialogue.typeSpeed = static_cast<uint16_t>(speed);
+        }
+        else if (keyword == "next") {
+            dialogue.next = takeWord(rest);
+            dialogue.hasNext = true;
+            if (dialogue.next.empty() || !rest.empty())
+                throw error(line, "expected 'next <label>'");
+        }
+        else if (keyword == "choice") {
+            PendingChoice choice;
+            choice.target = takeWord(rest);
+            choice.line = line;
+            if (!rest.empty() && rest[0] == '@')
+                choice.action = takeWord(rest).substr(1);
+            choice.text = rest;
+            if (choice.target.empty() || choice.text.empty())
+                throw error(line, "expected 'choice <label> [@action] <text>'");
+            dialogue.choices.push_back(std::move(choice));
+        }
+        else {
+            throw error(line, "unknown keyword '" + keyword + "'");
+        }
+    }
+
+public:
+    explicit DialogueCompiler(const std::string& name) : name(name) {}
+
+    CompiledDialogues compile(std::istream& in) {
+        dialogues.clear();
+        labels.clear();
+        std::string text;
+        for (size_t line = 1; std::getline(in, text); ++line) {
+            if (!text.empty() && text.back() == '\r')
+                text.pop_back();
+            parseLine(text, line);
+        }
+        if (dialogues.empty())
+            throw std::runtime_error(name + ": no dialogues");
+
+        CompiledDialogues result;
+        DialogueGraph& graph = result.graph;
+        for (auto& dialogue : dialogues)
+            graph.addNode(dialogue.text, dialogue.typeSpeed);
+        for (size_t id = 0; id < dialogues.size(); ++id) {
+            PendingDialogue& dialogue = dialogues[id];
+            DialogueId defaultNext = id + 1 < dialogues.size() ? static_cast<DialogueId>(id + 1) : noDialogue;
+            graph.node(static_cast<DialogueId>(id)).next = dialogue.hasNext ? resolve(dialogue.next, dialogue.line) : defaultNext;
+            for (auto& choice : dialogue.choices) {
+                uint32_t action = choice.action.empty() ? noAction : graph.addAction(choice.action);
+                graph.addChoice(static_cast<DialogueId>(id), choice.text, resolve(choice.target, choice.line), action);
+            }
+        }
+        result.start = 0;
+        result.end = static_cast<DialogueId>(dialogues.size() - 1);
+
+        DialogueAnalysis analysis = analyzeDialogues(graph, result.start);
+        auto where = [&](const DialogueIssue& issue) {
+            return issue.dialogue < dialogues.size() ? "dialogue '" + dialogues[issue.dialogue].label + "': " : std::string();
+        };
+        if (!analysis.ok()) {
+            const DialogueIssue& issue = analysis.errors.front();
+            throw error(issue.dialogue < dialogues.size() ? dialogues[issue.dialogue].line : 0, where(issue) + issue.message);
+        }
+        for (auto& issue : analysis.warnings)
+            result.warnings.push_back(name + ": " + where(issue) + issue.message);
+        graph.setAnalysis(std::move(analysis.infos));
+        return result;
+    }
+};
+
+/*
+ * Compiles scriptPath into imagePath. The image is written next to the old
+ * one and renamed over it, so a game mapping the old image never sees a
+ * half-written file.
+ */
+inline CompiledDialogues compileDialogueFile(const std::string& scriptPath, const std::string& imagePath) {
+    std::ifstream file(scriptPath, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Could not open " + scriptPath);
+    // Kept whole, so the image can record which version of the script it was made from
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::istringstream script(source);
+    CompiledDialogues compiled = DialogueCompiler(scriptPath).compile(script);
+
+    std::string temporaryPath = imagePath + ".tmp";
+    {
+        std::ofstream image(temporaryPath, std::ios::binary | std::ios::trunc);
+        compiled.graph.writeImage(image, compiled.start, compiled.end, &source);
+        if (!image.flush())
+            throw std::runtime_error("Could not write " + temporaryPath);
+    }
+    // rename does not replace an existing file on Windows
+    if (std::rename(temporaryPath.c_str(), imagePath.c_str()) != 0) {
+        std::remove(imagePath.c_str());
+        if (std::rename(temporaryPath.c_str(), imagePath.c_str()) != 0)
+            throw std::runtime_error("Could not replace " + imagePath);
+    }
+    return compiled;
+}
+
+/*
+ * Whether imagePath is a current image compiled from scriptPath as the
+ * script is now. Without the script, the image is all there is and counts
+ * as current.
+ */
+inline bool isDialogueImageCurrent(const std::string& scriptPath, const std::string& imagePath) {
+    DialogueImageHeader header;
+    std::ifstream image(imagePath, std::ios::binary);
+    if (!image.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, dialogueImageMagic, sizeof(header.magic)) != 0 || header.version != dialogueImageVersion)
+        return false;
+    std::ifstream file(scriptPath, std::ios::binary);
+    if (!file)
+        return true;
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return header.sourceBytes == source.size() && header.sourceHash == hashDialogueSource(source);
+}
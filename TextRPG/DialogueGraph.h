@@ -0,0 +1,485 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "DialogueImage.h"
+
+typedef uint32_t DialogueId;
+
+const DialogueId noDialogue = static_cast<DialogueId>(-1);
+const uint32_t noChoice = static_cast<uint32_t>(-1);
+const uint32_t noAction = static_cast<uint32_t>(-1);
+
+/* Offset and length of a string inside a StringArena */
+struct ArenaString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+/*
+ * Append-only character buffer where equal strings are stored once. Handles
+ * are offsets, so they stay valid while the buffer grows, and the dedup
+ * table is open-addressed so interning allocates nothing per string.
+ */
+class StringArena {
+private:
+    static const uint32_t emptySlot = static_cast<uint32_t>(-1);
+
+    std::vector<char> chars;
+    std::vector<ArenaString> table;
+    size_t count = 0;
+
+    static uint64_t hashBytes(const char* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    size_t findSlot(const char* data, size_t size) const {
+        size_t mask = table.size() - 1;
+        size_t slot = static_cast<size_t>(hashBytes(data, size)) & mask;
+        while (table[slot].offset != emptySlot) {
+            const ArenaString& entry = table[slot];
+            if (entry.length == size && std::memcmp(chars.data() + entry.offset, data, size) == 0)
+                break;
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void grow() {
+        std::vector<ArenaString> old(table.empty() ? 0 : table.size() * 2, ArenaString{ emptySlot, 0 });
+        old.swap(table);
+        if (table.empty())
+            table.assign(64, ArenaString{ emptySlot, 0 });
+        for (auto& entry : old) {
+            if (entry.offset != emptySlot)
+                table[findSlot(chars.data() + entry.offset, entry.length)] = entry;
+        }
+    }
+
+public:
+    ArenaString intern(const std::string& text) {
+        if ((count + 1) * 2 > table.size())
+            grow();
+        size_t slot = findSlot(text.data(), text.size());
+        if (table[slot].offset != emptySlot)
+            return table[slot];
+
+        if (chars.size() + text.size() > UINT32_MAX)
+            throw std::length_error("String arena is full");
+        ArenaString handle{ static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(text.size()) };
+        chars.insert(chars.end(), text.begin(), text.end());
+        table[slot] = handle;
+        ++count;
+        return handle;
+    }
+
+    const char* data(ArenaString text) const { return chars.data() + text.offset; }
+    std::string str(ArenaString text) const { return std::string(data(text), text.length); }
+    size_t size() const { return chars.size(); }
+
+    size_t memoryUsage() const { return chars.capacity() + table.capacity() * sizeof(ArenaString); }
+};
+
+struct DialogueNode {
+    ArenaString text;
+    DialogueId next;
+    // Choices of one dialogue are chained through DialogueChoice::nextChoice
+    uint32_t firstChoice;
+    uint32_t lastChoice;
+    uint16_t choiceCount;
+    uint16_t typeSpeed;
+};
+
+struct DialogueChoice {
+    ArenaString text;
+    // Becomes the dialogue's next one when the choice is picked
+    DialogueId target;
+    uint32_t nextChoice;
+    uint32_t action;
+};
+
+const uint32_t noDistance = static_cast<uint32_t>(-1);
+
+/* Per-dialogue results of analyzeDialogues (see DialogueAnalysis.h) */
+struct DialogueNodeInfo {
+    // Strongly connected component; dialogues that can lead back to each other share one
+    uint32_t component;
+    // Dialogues shown from here until the story ends on the shortest path, noDistance if it never can
+    uint32_t distanceToEnd;
+    // Choice number to pick on that path, 0 for a dialogue without choices
+    uint32_t bestChoice;
+    uint32_t reachable;
+};
+
+static_assert(sizeof(ArenaString) == 8 && sizeof(DialogueNode) == 24 && sizeof(DialogueChoice) == 20 && sizeof(DialogueNodeInfo) == 16,
+    "Dialogue records are stored in compiled images as they are laid out in memory");
+
+/*
+ * Dialogue nodes and choices in two flat arrays, linked by index. A node's
+ * id is its position, so lookups are plain array accesses and walking the
+ * story touches a few contiguous 24-byte records instead of heap objects.
+ *
+ * The arrays either live in the vectors below or in a mapped compiled image
+ * (see DialogueCompiler.h); accessors go through the views either way. Links
+ * rewired while playing only dirty the image pages they are on, and adding
+ * to a mapped graph first copies it to the heap.
+ */
+class DialogueGraph {
+private:
+    std::vector<DialogueNode> nodes;
+    std::vector<DialogueChoice> choices;
+    StringArena strings;
+    // Names of the actions a compiled script refers to, by action index
+    std::vector<ArenaString> actionNames;
+    // Empty until the graph is analyzed, cleared when it changes
+    std::vector<DialogueNodeInfo> infos;
+
+    std::shared_ptr<MappedFile> image;
+    DialogueNode* nodeBase = nullptr;
+    const DialogueChoice* choiceBase = nullptr;
+    const ArenaString* actionBase = nullptr;
+    const DialogueNodeInfo* infoBase = nullptr;
+    const char* charBase = nullptr;
+    size_t nodeCount = 0;
+    size_t choiceCount = 0;
+    size_t actionCount = 0;
+    size_t stringBytes = 0;
+
+    void syncViews() {
+        nodeBase = nodes.data();
+        choiceBase = choices.data();
+        actionBase = actionNames.data();
+        infoBase = infos.empty() ? nullptr : infos.data();
+        charBase = strings.data(ArenaString{ 0, 0 });
+        nodeCount = nodes.size();
+        choiceCount = choices.size();
+        actionCount = actionNames.size();
+        stringBytes = strings.size();
+    }
+
+    std::string readText(ArenaString text) const { return std::string(charBase + text.offset, text.length); }
+
+    void detachImage() {
+        if (!image)
+            return;
+        StringArena ownStrings;
+        std::vector<DialogueNode> ownNodes(nodeBase, nodeBase + nodeCount);
+        for (auto& node : ownNodes)
+            node.text = ownStrings.intern(readText(node.text));
+        std::vector<DialogueChoice> ownChoices(choiceBase, choiceBase + choiceCount);
+        for (auto& choice : ownChoices)
+            choice.text = ownStrings.intern(readText(choice.text));
+        std::vector<ArenaString> ownActions(actionBase, actionBase + actionCount);
+        for (auto& name : ownActions)
+            name = ownStrings.intern(readText(name));
+        std::vector<DialogueNodeInfo> ownInfos;
+        if (infoBase)
+            ownInfos.assign(infoBase, infoBase + nodeCount);
+
+        nodes.swap(ownNodes);
+        choices.swap(ownChoices);
+        actionNames.swap(ownActions);
+        infos.swap(ownInfos);
+        strings = std::move(ownStrings);
+        image.reset();
+        syncViews();
+    }
+
+    static void checkSection(const MappedFile& file, uint32_t offset, size_t count, size_t recordSize) {
+        if (offset % 4 != 0 || offset > file.size() || count > (file.size() - offset) / recordSize)
+            throw std::runtime_error("Dialogue image " + file.getPath() + " is damaged");
+    }
+
+    /*
+     * Every index and string of a mapped image, checked once so the graph
+     * can trust them afterwards: a truncated or damaged file is rejected
+     * here instead of being read out of bounds later.
+     */
+    static void checkRecords(const MappedFile& file, const DialogueImageHeader& header) {
+        const char* base = file.data();
+        const DialogueNode* imageNodes = reinterpret_cast<const DialogueNode*>(base + header.nodeOffset);
+        const DialogueChoice* imageChoices = reinterpret_cast<const DialogueChoice*>(base + header.choiceOffset);
+        const ArenaString* imageActions = reinterpret_cast<const ArenaString*>(base + header.actionOffset);
+        auto damaged = [&](const std::string& what) {
+            return std::runtime_error("Dialogue image " + file.getPath() + " is damaged: " + what);
+        };
+        auto validText = [&](ArenaString text) { return static_cast<uint64_t>(text.offset) + text.length <= header.stringBytes; };
+        auto validDialogue = [&](DialogueId id) { return id == noDialogue || id < header.nodeCount; };
+
+        for (uint32_t i = 0; i < header.choiceCount; ++i) {
+            const DialogueChoice& choice = imageChoices[i];
+            if (!validText(choice.text) || !validDialogue(choice.target)
+                || (choice.nextChoice != noChoice && choice.nextChoice >= header.choiceCount)
+                || (choice.action != noAction && choice.action >= header.actionCount))
+                throw damaged("choice " + std::to_string(i));
+        }
+        for (uint32_t i = 0; i < header.actionCount; ++i) {
+            if (!validText(imageActions[i]))
+                throw damaged("action " + std::to_string(i));
+        }
+        // Chains may not loop or run past their count, and together hold no more than every choice
+        uint64_t chained = 0;
+        for (uint32_t id = 0; id < header.nodeCount; ++id) {
+            const DialogueNode& node = imageNodes[id];
+            bool valid = validText(node.text) && validDialogue(node.next) && node.typeSpeed != 0;
+            chained += node.choiceCount;
+            valid = valid && chained <= header.choiceCount;
+            uint32_t index = node.firstChoice;
+            uint32_t last = noChoice;
+            for (uint16_t walked = 0; valid && walked < node.choiceCount; ++walked) {
+                valid = index < header.choiceCount;
+                last = index;
+                index = valid ? imageChoices[index].nextChoice : noChoice;
+            }
+            if (!valid || index != noChoice || last != node.lastChoice)
+                throw damaged("dialogue " + std::to_string(id));
+        }
+        if (header.infoOffset != 0) {
+            const DialogueNodeInfo* imageInfos = reinterpret_cast<const DialogueNodeInfo*>(base + header.infoOffset);
+            for (uint32_t id = 0; id < header.nodeCount; ++id) {
+                if (imageInfos[id].component >= header.nodeCount || imageInfos[id].bestChoice > imageNodes[id].choiceCount)
+                    throw damaged("analysis of dialogue " + std::to_string(id));
+            }
+        }
+    }
+
+public:
+    DialogueGraph() { syncViews(); }
+
+    DialogueGraph(const DialogueGraph& other)
+        : nodes(other.nodes), choices(other.choices), strings(other.strings), actionNames(other.actionNames), infos(other.infos) {
+        syncViews();
+        if (other.image) {
+            attachImage(std::make_shared<MappedFile>(other.image->getPath()));
+            if (nodeCount != other.nodeCount)
+                throw std::runtime_error("Dialogue image " + image->getPath() + " changed while mapped");
+            if (!other.infoBase)
+                infoBase = nullptr;
+            // Only nodes changed since mapping are written, so the copy shares every other page
+            for (size_t i = 0; i < nodeCount; ++i) {
+                if (std::memcmp(&nodeBase[i], &other.nodeBase[i], sizeof(DialogueNode)) != 0)
+                    nodeBase[i] = other.nodeBase[i];
+            }
+        }
+    }
+
+    DialogueGraph(DialogueGraph&& other) { *this = std::move(other); }
+
+    DialogueGraph& operator=(const DialogueGraph& other) {
+        if (this != &other)
+            *this = DialogueGraph(other);
+        return *this;
+    }
+
+    DialogueGraph& operator=(DialogueGraph&& other) {
+        if (this == &other)
+            return *this;
+        nodes = std::move(other.nodes);
+        choices = std::move(other.choices);
+        strings = std::move(other.strings);
+        actionNames = std::move(other.actionNames);
+        infos = std::move(other.infos);
+        image = std::move(other.image);
+        nodeBase = other.nodeBase;
+        choiceBase = other.choiceBase;
+        actionBase = other.actionBase;
+        infoBase = other.infoBase;
+        charBase = other.charBase;
+        nodeCount = other.nodeCount;
+        choiceCount = other.choiceCount;
+        actionCount = other.actionCount;
+        stringBytes = other.stringBytes;
+
+        other.nodes.clear();
+        other.choices.clear();
+        other.strings = StringArena();
+        other.actionNames.clear();
+        other.infos.clear();
+        other.syncViews();
+        return *this;
+    }
+
+    size_t size() const { return nodeCount; }
+    size_t choiceTotal() const { return choiceCount; }
+    size_t actionTotal() const { return actionCount; }
+    bool contains(DialogueId id) const { return id < nodeCount; }
+    bool isMapped() const { return static_cast<bool>(image); }
+
+    DialogueNode& node(DialogueId id) { return nodeBase[id]; }
+    const DialogueNode& node(DialogueId id) const { return nodeBase[id]; }
+    const DialogueChoice& choice(uint32_t index) const { return choiceBase[index]; }
+
+    std::string text(ArenaString text) const { return readText(text); }
+    std::string actionName(uint32_t index) const { return readText(actionBase[index]); }
+
+    DialogueId addNode(const std::string& text, uint16_t typeSpeed) {
+        if (nodeCount >= noDialogue)
+            throw std::length_error("Too many dialogues");
+        detachImage();
+        nodes.push_back(DialogueNode{ strings.intern(text), noDialogue, noChoice, noChoice, 0, typeSpeed });
+        infos.clear();
+        syncViews();
+        return static_cast<DialogueId>(nodes.size() - 1);
+    }
+
+    uint32_t addChoice(DialogueId id, const std::string& text, DialogueId target, uint32_t action) {
+        if (!contains(id) || (target != noDialogue && !contains(target)))
+            throw std::invalid_argument("Choice links a dialogue the graph does not hold");
+        if (nodeBase[id].choiceCount == UINT16_MAX)
+            throw std::length_error("Too many choices for one dialogue");
+        detachImage();
+
+        DialogueNode& owner = nodes[id];
+        uint32_t index = static_cast<uint32_t>(choices.size());
+        choices.push_back(DialogueChoice{ strings.intern(text), target, noChoice, action });
+        if (owner.lastChoice == noChoice)
+            owner.firstChoice = index;
+        else
+            choices[owner.lastChoice].nextChoice = index;
+        owner.lastChoice = index;
+        ++owner.choiceCount;
+        infos.clear();
+        syncViews();
+        return index;
+    }
+
+    /* Index of the named action, registered on first use */
+    uint32_t addAction(const std::string& name) {
+        uint32_t index = findAction(name);
+        if (index != noAction)
+            return index;
+        detachImage();
+        actionNames.push_back(strings.intern(name));
+        syncViews();
+        return static_cast<uint32_t>(actionNames.size() - 1);
+    }
+
+    uint32_t findAction(const std::string& name) const {
+        for (size_t i = 0; i < actionCount; ++i) {
+            if (actionBase[i].length == name.size() && std::memcmp(charBase + actionBase[i].offset, name.data(), name.size()) == 0)
+                return static_cast<uint32_t>(i);
+        }
+        return noAction;
+    }
+
+    bool isAnalyzed() const { return infoBase != nullptr; }
+    const DialogueNodeInfo& info(DialogueId id) const { return infoBase[id]; }
+
+    void setAnalysis(std::vector<DialogueNodeInfo> results) {
+        if (results.size() != nodeCount)
+            throw std::invalid_argument("Analysis does not match the dialogue graph");
+        detachImage();
+        infos = std::move(results);
+        syncViews();
+    }
+
+    /* Links were changed by hand, so the stored paths no longer hold; a mapped image stays mapped */
+    void clearAnalysis() {
+        std::vector<DialogueNodeInfo>().swap(infos);
+        infoBase = nullptr;
+    }
+
+    /* number is 1-based, as shown in the menu; noChoice if out of range */
+    uint32_t choiceAt(DialogueId id, size_t number) const {
+        const DialogueNode& owner = nodeBase[id];
+        if (number < 1 || number > owner.choiceCount)
+            return noChoice;
+        uint32_t index = owner.firstChoice;
+        while (--number > 0)
+            index = choiceBase[index].nextChoice;
+        return index;
+    }
+
+    /* Writes the graph as a compiled image that attachImage can map; source describes the script it came from */
+    void writeImage(std::ostream& out, DialogueId start, DialogueId end, const std::string* source = nullptr) const {
+        DialogueImageHeader header;
+        std::memcpy(header.magic, dialogueImageMagic, sizeof(header.magic));
+        header.version = dialogueImageVersion;
+        header.nodeCount = static_cast<uint32_t>(nodeCount);
+        header.choiceCount = static_cast<uint32_t>(choiceCount);
+        header.actionCount = static_cast<uint32_t>(actionCount);
+        header.start = start;
+        header.end = end;
+        header.stringBytes = static_cast<uint32_t>(stringBytes);
+        header.sourceBytes = source ? static_cast<uint32_t>(source->size()) : 0;
+        header.sourceHash = source ? hashDialogueSource(*source) : 0;
+
+        uint64_t offset = sizeof(DialogueImageHeader);
+        header.nodeOffset = static_cast<uint32_t>(offset);
+        offset += nodeCount * sizeof(DialogueNode);
+        header.choiceOffset = static_cast<uint32_t>(offset);
+        offset += choiceCount * sizeof(DialogueChoice);
+        header.actionOffset = static_cast<uint32_t>(offset);
+        offset += actionCount * sizeof(ArenaString);
+        header.infoOffset = infoBase ? static_cast<uint32_t>(offset) : 0;
+        offset += infoBase ? nodeCount * sizeof(DialogueNodeInfo) : 0;
+        header.stringOffset = static_cast<uint32_t>(offset);
+        if (offset + stringBytes > UINT32_MAX)
+            throw std::length_error("Dialogue graph is too large for an image");
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(nodeBase), nodeCount * sizeof(DialogueNode));
+        out.write(reinterpret_cast<const char*>(choiceBase), choiceCount * sizeof(DialogueChoice));
+        out.write(reinterpret_cast<const char*>(actionBase), actionCount * sizeof(ArenaString));
+        if (infoBase)
+            out.write(reinterpret_cast<const char*>(infoBase), nodeCount * sizeof(DialogueNodeInfo));
+        out.write(charBase, stringBytes);
+    }
+
+    /*
+     * Runs the graph straight from a mapped image, dropping what it held
+     * before. The records are used in place, once checkRecords has gone over
+     * them; that one pass reads every page of the image.
+     */
+    DialogueImageHeader attachImage(std::shared_ptr<MappedFile> file) {
+        DialogueImageHeader header;
+        if (file->size() < sizeof(header))
+            throw std::runtime_error("Dialogue image " + file->getPath() + " is too small");
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (std::memcmp(header.magic, dialogueImageMagic, sizeof(header.magic)) != 0 || header.version != dialogueImageVersion)
+            throw std::runtime_error(file->getPath() + " is not a dialogue image of version " + std::to_string(dialogueImageVersion));
+        checkSection(*file, header.nodeOffset, header.nodeCount, sizeof(DialogueNode));
+        checkSection(*file, header.choiceOffset, header.choiceCount, sizeof(DialogueChoice));
+        checkSection(*file, header.actionOffset, header.actionCount, sizeof(ArenaString));
+        checkSection(*file, header.stringOffset, header.stringBytes, 1);
+        if (header.infoOffset != 0)
+            checkSection(*file, header.infoOffset, header.nodeCount, sizeof(DialogueNodeInfo));
+        if ((header.start != noDialogue && header.start >= header.nodeCount) || (header.end != noDialogue && header.end >= header.nodeCount))
+            throw std::runtime_error("Dialogue image " + file->getPath() + " is damaged");
+        checkRecords(*file, header);
+
+        std::vector<DialogueNode>().swap(nodes);
+        std::vector<DialogueChoice>().swap(choices);
+        std::vector<ArenaString>().swap(actionNames);
+        std::vector<DialogueNodeInfo>().swap(infos);
+        strings = StringArena();
+
+        char* base = file->data();
+        nodeBase = reinterpret_cast<DialogueNode*>(base + header.nodeOffset);
+        choiceBase = reinterpret_cast<const DialogueChoice*>(base + header.choiceOffset);
+        actionBase = reinterpret_cast<const ArenaString*>(base + header.actionOffset);
+        infoBase = header.infoOffset != 0 ? reinterpret_cast<const DialogueNodeInfo*>(base + header.infoOffset) : nullptr;
+        charBase = base + header.stringOffset;
+        nodeCount = header.nodeCount;
+        choiceCount = header.choiceCount;
+        actionCount = header.actionCount;
+        stringBytes = header.stringBytes;
+        image = std::move(file);
+        return header;
+    }
+
+    /* Heap bytes only; a mapped image is backed by its file */
+    size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(DialogueNode) + choices.capacity() * sizeof(DialogueChoice)
+            + actionNames.capacity() * sizeof(ArenaString) + infos.capacity() * sizeof(DialogueNodeInfo) + strings.memoryUsage();
+    }
+};
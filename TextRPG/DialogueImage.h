@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Private copy-on-write mapping of a whole file. Pages are read from the
+ * file on first access; writing to one gives this process its own copy and
+ * never reaches the file, so the mapping can be used as mutable memory.
+ */
+class MappedFile {
+private:
+    std::string path;
+    char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) : path(path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Could not open " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            throw std::runtime_error("Could not map empty file " + path);
+        }
+        length = static_cast<size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping)
+            base = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+        if (!base) {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Could not map " + path);
+        }
+#else
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            throw std::runtime_error("Could not open " + path);
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+            close(descriptor);
+            throw std::runtime_error("Could not map empty file " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Could not map " + path);
+        base = static_cast<char*>(address);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(base, length);
+#endif
+    }
+
+    const std::string& getPath() const { return path; }
+    char* data() { return base; }
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+const char dialogueImageMagic[4] = { 'D', 'L', 'G', 'I' };
+const uint32_t dialogueImageVersion = 3;
+
+/*
+ * Start of a compiled dialogue image. The sections it points to hold
+ * DialogueNode, DialogueChoice, ArenaString and DialogueNodeInfo records
+ * exactly as they are laid out in memory, so a mapped image is used in place without parsing.
+ */
+struct DialogueImageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t choiceCount;
+    uint32_t actionCount;
+    uint32_t start;
+    uint32_t end;
+    uint32_t stringBytes;
+    // Byte offsets from the start of the image
+    uint32_t nodeOffset;
+    uint32_t choiceOffset;
+    uint32_t actionOffset;
+    // DialogueNodeInfo per node; 0 when the image was written without an analysis
+    uint32_t infoOffset;
+    uint32_t stringOffset;
+    // Size and hashDialogueSource of the script the image was compiled from; 0 when it was not
+    uint32_t sourceBytes;
+    uint64_t sourceHash;
+};
+
+/* FNV-1a over a script's bytes, enough to notice it was edited after compiling */
+inline uint64_t hashDialogueSource(const std::string& source) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : source) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "DialogueGraph.h"
+#include <cstddef>
+#include <istream>
+#include <vector>
+
+/*
+ * Scripted answers for a headless run: either a fixed list of choice
+ * numbers or a stream of whitespace-separated numbers, i.e. exactly what a
+ * player would type at the "Enter your choice" prompts.
+ */
+class DialogueScript {
+private:
+    const std::vector<int>* inputs = nullptr;
+    size_t position = 0;
+    std::istream* stream = nullptr;
+
+public:
+    explicit DialogueScript(const std::vector<int>& inputs) : inputs(&inputs) {}
+    explicit DialogueScript(std::istream& stream) : stream(&stream) {}
+
+    /* false once the script has no answers left */
+    bool next(int& choice) {
+        if (inputs) {
+            if (position >= inputs->size())
+                return false;
+            choice = (*inputs)[position++];
+            return true;
+        }
+        return static_cast<bool>(*stream >> choice);
+    }
+};
+
+class Game;
+
+struct HeadlessOptions {
+    // Choice actions usually talk to the player (fights, prompts), so they are skipped by default
+    bool runActions = false;
+    // Required when runActions is set
+    Game* game = nullptr;
+    // Guards against cycles in the graph
+    size_t maxSteps = 1 << 20;
+};
+
+struct DialogueRun {
+    std::vector<DialogueId> path;
+    // Same format as DialogueSystem::choices: choice number, or -1 for a dialogue without choices
+    std::vector<int> choices;
+    // Reached a dialogue with no next one, rather than running out of script or steps
+    bool completed = false;
+
+    void clear() {
+        path.clear();
+        choices.clear();
+        completed = false;
+    }
+};
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "Logger.h"
+#include "CombatLog.h"
+#include "CombatRules.h"
 #include "inventory.h"
 #include <fstream>
 #include <string>
@@ -23,21 +25,21 @@ public:
 
 	Entity(const Entity& other)
 		: id(other.id), type(other.type), name(other.name), health(other.health), damage(other.damage), defense(other.defense), expByKill(other.expByKill), logger("Entity") {
-		logger.debug("Entity<" + std::to_string(id) + "> copied");
+		logger.debugf("Entity<{}> copied", id);
 	}
 
 	Entity(int id, std::string type, std::string name, int health, int damage, int defense, int expByKill)
 		: id(id), type(type), name(name), health(health), damage(damage), defense(defense), expByKill(expByKill) {
-		logger.debug("Entity<" + std::to_string(id) + "> created");
+		logger.debugf("Entity<{}> created", id);
 	}
 
 	~Entity() {
-		logger.debug("Entity<" + std::to_string(id) + "> destroyed");
+		logger.debugf("Entity<{}> destroyed", id);
 	}
 
 	size_t getId() const { return id; }
 	std::string getType() const { return type; }
-	std::string getName() const { return name; }
+	const std::string& getName() const { return name; }
 	int getHealth() const { return health; }
 	int getDamage() const { return damage; }
 	int getDefense() const { return defense; }
@@ -45,55 +47,55 @@ public:
 
 	bool isAlive() const { return health > 0; }
 
-	virtual void attack(Entity& target) {
-		logger.debug("Entity<" + std::to_string(id) + "> attacks Entity<" + std::to_string(target.id) + ">");
+	virtual void attack(Entity& target, Random& random, CombatLog& log) {
+		LOG_DEBUGF(logger, "Entity<{}> attacks Entity<{}>", id, target.id);
 
 		if (!target.isAlive()) {
-			logger.debug("Entity<" + std::to_string(target.id) + "> can't be attacked because it is already dead");
+			LOG_DEBUGF(logger, "Entity<{}> can't be attacked because it is already dead", target.id);
 			return;
 		}
-		std::cout << "\033[34m" << "[~] " << getName() << " attacking " << target.getName() << "\033[0m" << std::endl;
+		log.push(CombatEventType::ATTACK, name, target.name);
 
-		if (rand() % 100 < 25)
+		if (isDodged(random))
 		{
-			logger.debug("Entity<" + std::to_string(target.id) + "> dodged the attack");
-			std::cout << "\033[31m" << "[-] " << target.getName() << " dodged the attack " << getName() << "\033[0m" << std::endl;
+			LOG_DEBUGF(logger, "Entity<{}> dodged the attack", target.id);
+			log.push(CombatEventType::DODGE, name, target.name);
 			return;
 		}
 
-		target.takeDamage(damage);
+		target.takeDamage(damage, log);
 	}
 
-	virtual void takeDamage(int amount)
+	virtual void takeDamage(int amount, CombatLog& log)
 	{
 		if (!isAlive()) {
-			logger.debug("Entity<" + std::to_string(id) + "> can't take damage because it is already dead");
+			LOG_DEBUGF(logger, "Entity<{}> can't take damage because it is already dead", id);
 			return;
 		}
 
-		int damage = amount - defense;
-		if (damage <= 0) {
-			logger.debug("Entity<" + std::to_string(id) + "> takes no damage");
-			std::cout << "\033[31m" << "[-] " << getName() << " takes no damage" << "\033[0m" << std::endl;
+		int damage = damageAfterDefense(amount, defense);
+		if (damage == 0) {
+			LOG_DEBUGF(logger, "Entity<{}> takes no damage", id);
+			log.push(CombatEventType::NO_DAMAGE, name);
 			return;
 		}
 
-		if (health - damage < 0) {
-			logger.debug("Entity<" + std::to_string(id) + "> takes " + std::to_string(health) + " damage and died");
+		if (healthAfterDamage(health, damage) == 0) {
+			LOG_DEBUGF(logger, "Entity<{}> takes {} damage and died", id, health);
 			health = 0;
-			std::cout << "\033[32m" << "[+] " << getName() << " takes " << damage << " damage and died" << "\033[0m" << std::endl;
+			log.push(CombatEventType::DEATH, name, std::string(), damage);
 			return;
 		}
 
-		logger.debug("Entity<" + std::to_string(id) + "> takes " + std::to_string(damage) + " damage, new hp: " + std::to_string(health - damage));
+		LOG_DEBUGF(logger, "Entity<{}> takes {} damage, new hp: {}", id, damage, health - damage);
 		health -= damage;
-		std::cout << "\033[32m" << "[+] " << getName() << " takes " << damage << " damage, " << health << " hp left" << "\033[0m" << std::endl;
+		log.push(CombatEventType::DAMAGE, name, std::string(), damage, health);
 	}
 
 	virtual void display() {
-		logger.debug("Displaying Entity<" + std::to_string(id) + ">(" + name + ") stats");
+		logger.debugf("Displaying Entity<{}>({}) stats", id, name);
 
-		std::cout << "[~] " + type + " " + name + " stats:" << std::endl;
+		std::cout << "[~] " << type << " " << name << " stats:" << std::endl;
 		std::cout << "- Type    : "  << type    << std::endl;
 		std::cout << "- Name    : "  << name    << std::endl;
 		std::cout << "- Health  : "  << health  << std::endl;
@@ -152,51 +154,50 @@ public:
 	int getLevel() const { return level; }
 	int getExperience() const { return experience; }
 
-	void levelUp() {
-		while (experience >= (level + 1) * 100) {
-			std::cout << "\033[32m" << "[+] Leveled up" << "\033[0m" << std::endl;
-			logger.debug("Character<" + std::to_string(id) + "> leveled up");
-			level++;
-			experience -= (level + 1) * 100;
+	void levelUp(CombatLog& log) {
+		while (levelUpOnce(level, experience)) {
+			log.push(CombatEventType::LEVEL_UP, name, std::string(), level);
+			logger.debugf("Character<{}> leveled up", id);
 		}
 	}
 
-	void gainExperience(int amount) {
-		logger.debug("Character<" + std::to_string(id) + "> gained " + std::to_string(amount) + " experience");
-		std::cout << "\033[32m" << "[+] Gained " << amount << " experience" << "\033[0m" << std::endl;
+	void gainExperience(int amount, CombatLog& log) {
+		logger.debugf("Character<{}> gained {} experience", id, amount);
+		log.push(CombatEventType::EXPERIENCE, name, std::string(), amount);
 		experience += amount;
-		levelUp();
+		levelUp(log);
 	}
 
 	void takeItem(const Item& item) { 
-		logger.debug(name + " took item " + item.getName());
+		logger.debugf("{} took item {}", name, item.getName());
 		inventory->addItem(std::make_shared<Item>(item)); 
 	}
 
-	void useItem(const std::string& name) {
-		if (!inventory->useItem(name)) {
-			logger.debug("Character<" + std::to_string(id) + "> tried to use " + name + " but it was not found in inventory");
-			std::cout << "\033[31m" << "[~] Item " << name << " not found in inventory" << "\033[0m" << std::endl;
+	void useItem(const std::string& item, CombatLog& log) {
+		if (!inventory->useItem(item)) {
+			logger.debugf("Character<{}> tried to use {} but it was not found in inventory", id, item);
+			log.push(CombatEventType::ITEM_MISSING, name, item);
+			return;
 		}
-		std::cout << "\033[32m" << "[~] Item " << name << " successfully used" << "\033[0m" << std::endl;
+		log.push(CombatEventType::ITEM_USED, name, item);
 	}
 
-	void heal() {
+	void heal(CombatLog& log) {
 		if (!inventory->hasItem("Heal Potion")) {
-			logger.debug("Character<" + std::to_string(id) + "> tried to use Heal Potion but it was not found in inventory");
-			std::cout << "\033[31m" << "[~] Item Heal Potion not found in inventory" << "\033[0m" << std::endl;
+			logger.debugf("Character<{}> tried to use Heal Potion but it was not found in inventory", id);
+			log.push(CombatEventType::NO_POTION, name);
 			return;
 		}
-		logger.debug("Character<" + std::to_string(id) + "> used Heal Potion");
-		std::cout << "\033[32m" << "[~] Item Heal Potion successfully used, healed 25hp" << "\033[0m" << std::endl;
+		logger.debugf("Character<{}> used Heal Potion", id);
+		log.push(CombatEventType::HEAL, name);
 		inventory->useItem("Heal Potion");
 	}
 
-	void attack(Entity& target) {
-		Entity::attack(target);
+	void attack(Entity& target, Random& random, CombatLog& log) override {
+		Entity::attack(target, random, log);
 		
 		if (!target.isAlive())
-			gainExperience(target.getExpByKill());
+			gainExperience(target.getExpByKill(), log);
 	}
 
 	void display() override {
@@ -0,0 +1,240 @@
+#pragma once
+#include "BatchDamage.h"
+#include "CombatLog.h"
+#include "CombatRules.h"
+#include "Entity.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Names and types of a store, each kept once however many entities share it */
+class EntityNames {
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> indices;
+
+public:
+    uint32_t intern(const std::string& name) {
+        auto found = indices.find(name);
+        if (found != indices.end())
+            return found->second;
+        uint32_t index = static_cast<uint32_t>(names.size());
+        names.push_back(name);
+        indices.emplace(name, index);
+        return index;
+    }
+
+    const std::string& get(uint32_t index) const { return names[index]; }
+    size_t size() const { return names.size(); }
+};
+
+/*
+ * Entities of a large battle as parallel arrays: one for each stat and one
+ * of alive flags, with names and types in a side table. A scan over who is
+ * alive reads one byte per entity and area damage reads health and defense
+ * only, in loops the compiler can vectorize; an Entity with its logger and
+ * strings is several hundred bytes. Rows are addressed by index, which stays
+ * valid until compact.
+ */
+class EntityStore {
+private:
+    std::vector<int32_t> health;
+    std::vector<int32_t> damage;
+    std::vector<int32_t> defense;
+    std::vector<int32_t> expByKill;
+    std::vector<uint8_t> alive;
+    std::vector<size_t> ids;
+    std::vector<uint32_t> nameIndex;
+    std::vector<uint32_t> typeIndex;
+    // Shared with copies; stores only ever append to it
+    std::shared_ptr<EntityNames> names = std::make_shared<EntityNames>();
+    size_t aliveCount = 0;
+    // Health lost by each entity to the last batch of damage
+    std::vector<int32_t> taken;
+
+    size_t resolveBatch(const int32_t* amounts, int amount, std::vector<DamageEvent>* events) {
+        taken.resize(health.size());
+        size_t deaths = resolveBatchDamage(health.data(), defense.data(), amounts, amount, alive.data(), taken.data(), health.size());
+        aliveCount -= deaths;
+        if (events) {
+            // Whoever has health left or just lost some was alive when the batch hit
+            for (size_t i = 0; i < health.size(); ++i) {
+                if (health[i] == 0 && taken[i] == 0)
+                    continue;
+                DamageResult result = taken[i] == 0 ? DamageResult::NO_DAMAGE : health[i] == 0 ? DamageResult::DIED : DamageResult::DAMAGED;
+                // A killing blow reports its full damage, not just the health that was left
+                int32_t damage = damageAfterDefense(amounts ? amounts[i] : amount, defense[i]);
+                events->push_back(DamageEvent{ static_cast<uint32_t>(i), damage, health[i], result });
+            }
+        }
+        return deaths;
+    }
+
+public:
+    size_t size() const { return health.size(); }
+    bool empty() const { return health.empty(); }
+    size_t livingCount() const { return aliveCount; }
+
+    void reserve(size_t count) {
+        health.reserve(count);
+        damage.reserve(count);
+        defense.reserve(count);
+        expByKill.reserve(count);
+        alive.reserve(count);
+        ids.reserve(count);
+        nameIndex.reserve(count);
+        typeIndex.reserve(count);
+    }
+
+    void clear() {
+        health.clear();
+        damage.clear();
+        defense.clear();
+        expByKill.clear();
+        alive.clear();
+        ids.clear();
+        nameIndex.clear();
+        typeIndex.clear();
+        aliveCount = 0;
+    }
+
+    size_t add(size_t id, const std::string& type, const std::string& name, int health, int damage, int defense, int expByKill) {
+        this->health.push_back(health > 0 ? health : 0);
+        this->damage.push_back(damage);
+        this->defense.push_back(defense);
+        this->expByKill.push_back(expByKill);
+        alive.push_back(health > 0 ? 1 : 0);
+        ids.push_back(id);
+        nameIndex.push_back(names->intern(name));
+        typeIndex.push_back(names->intern(type));
+        aliveCount += health > 0 ? 1 : 0;
+        return this->health.size() - 1;
+    }
+
+    size_t add(const Entity& entity) {
+        return add(entity.getId(), entity.getType(), entity.getName(), entity.getHealth(), entity.getDamage(), entity.getDefense(), entity.getExpByKill());
+    }
+
+    /* The row as a Monster, for code that needs an Entity */
+    std::shared_ptr<Monster> makeMonster(size_t index) const {
+        return std::make_shared<Monster>(static_cast<int>(ids[index]), getName(index), health[index], damage[index], defense[index], expByKill[index]);
+    }
+
+    size_t getId(size_t index) const { return ids[index]; }
+    const std::string& getName(size_t index) const { return names->get(nameIndex[index]); }
+    const std::string& getType(size_t index) const { return names->get(typeIndex[index]); }
+    int getHealth(size_t index) const { return health[index]; }
+    int getDamage(size_t index) const { return damage[index]; }
+    int getDefense(size_t index) const { return defense[index]; }
+    int getExpByKill(size_t index) const { return expByKill[index]; }
+    bool isAlive(size_t index) const { return alive[index] != 0; }
+
+    /* First living entity at or after from, size() if there is none */
+    size_t firstAlive(size_t from = 0) const {
+        if (from >= alive.size())
+            return alive.size();
+        const void* found = std::memchr(alive.data() + from, 1, alive.size() - from);
+        return found ? static_cast<const uint8_t*>(found) - alive.data() : alive.size();
+    }
+
+    /* Counts the alive flags again; livingCount keeps the same number up to date */
+    size_t countAlive() const {
+        size_t count = 0;
+        for (size_t i = 0; i < alive.size(); ++i)
+            count += alive[i];
+        return count;
+    }
+
+    /* takeDamage for one entity: the health it lost */
+    int applyDamage(size_t index, int amount) {
+        if (!alive[index])
+            return 0;
+        int lost = damageAfterDefense(amount, defense[index]);
+        health[index] = healthAfterDamage(health[index], lost);
+        if (health[index] == 0) {
+            alive[index] = 0;
+            --aliveCount;
+        }
+        return lost;
+    }
+
+    /*
+     * takeDamage(amount) for every entity at once, as an area attack (see
+     * BatchDamage.h). Dead entities have 0 health and stay at 0, so the math
+     * needs no branch. With events, what happened to each entity that was
+     * alive is appended afterwards. Returns how many died.
+     */
+    size_t applyDamageToAll(int amount, std::vector<DamageEvent>* events = nullptr) {
+        return resolveBatch(nullptr, amount, events);
+    }
+
+    /* The same with amounts[i] hitting entity i, e.g. an attack that weakens with distance */
+    size_t applyDamages(const std::vector<int32_t>& amounts, std::vector<DamageEvent>* events = nullptr) {
+        if (amounts.size() != health.size())
+            throw std::invalid_argument("One damage amount per entity is needed");
+        return resolveBatch(amounts.data(), 0, events);
+    }
+
+    /* Puts health back as it is in snapshot, a copy of this store taken before the fight; copies all of it otherwise */
+    void restoreHealth(const EntityStore& snapshot) {
+        if (snapshot.names != names || snapshot.size() != size()) {
+            *this = snapshot;
+            return;
+        }
+        std::memcpy(health.data(), snapshot.health.data(), health.size() * sizeof(int32_t));
+        std::memcpy(alive.data(), snapshot.alive.data(), alive.size());
+        aliveCount = snapshot.aliveCount;
+    }
+
+    /* Drops the dead rows, keeping the order of the rest; indices change */
+    size_t compact() {
+        size_t kept = 0;
+        for (size_t i = 0; i < health.size(); ++i) {
+            if (!alive[i])
+                continue;
+            health[kept] = health[i];
+            damage[kept] = damage[i];
+            defense[kept] = defense[i];
+            expByKill[kept] = expByKill[i];
+            alive[kept] = 1;
+            ids[kept] = ids[i];
+            nameIndex[kept] = nameIndex[i];
+            typeIndex[kept] = typeIndex[i];
+            ++kept;
+        }
+        size_t removed = health.size() - kept;
+        health.resize(kept);
+        damage.resize(kept);
+        defense.resize(kept);
+        expByKill.resize(kept);
+        alive.resize(kept);
+        ids.resize(kept);
+        nameIndex.resize(kept);
+        typeIndex.resize(kept);
+        return removed;
+    }
+
+    /* Bytes held by the arrays; the name table is shared and not counted */
+    size_t memoryUsage() const {
+        return (health.capacity() + damage.capacity() + defense.capacity() + expByKill.capacity()) * sizeof(int32_t)
+            + alive.capacity() + ids.capacity() * sizeof(size_t)
+            + (nameIndex.capacity() + typeIndex.capacity()) * sizeof(uint32_t);
+    }
+};
+
+/* The events Entity::takeDamage pushes, for a whole batch */
+inline void logDamageEvents(CombatLog& log, const EntityStore& store, const std::vector<DamageEvent>& events) {
+    for (auto& event : events) {
+        const std::string& name = store.getName(event.target);
+        if (event.result == DamageResult::NO_DAMAGE)
+            log.push(CombatEventType::NO_DAMAGE, name);
+        else if (event.result == DamageResult::DIED)
+            log.push(CombatEventType::DEATH, name, std::string(), event.damage);
+        else
+            log.push(CombatEventType::DAMAGE, name, std::string(), event.damage, event.healthLeft);
+    }
+}
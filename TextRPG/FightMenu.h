@@ -0,0 +1,118 @@
+#pragma once
+#include "Entity.h"
+#include <algorithm>
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class FightAction {
+    ATTACK = 1,
+    HEAL = 2,
+    SHOW = 3
+};
+
+/*
+ * Menu of a fight that lives as long as the fight does. Targets are only
+ * added when an entity joins and removed when one dies; a turn formats the
+ * menu into a buffer that keeps its capacity and reads the answer, so it
+ * allocates nothing however many enemies there are.
+ */
+class FightMenu {
+private:
+    std::vector<std::shared_ptr<Entity>> targets;
+    std::string screen;
+
+    void appendNumber(int value) {
+        char digits[16];
+        int length = std::snprintf(digits, sizeof(digits), "%d", value);
+        screen.append(digits, static_cast<size_t>(length));
+    }
+
+    void appendEntry(int number, const std::string& text) {
+        screen += "- ";
+        appendNumber(number);
+        screen += '.';
+        screen += text;
+        screen += '\n';
+    }
+
+    void beginScreen(const char* heading) {
+        screen.clear();
+        screen += "\033[34m";
+        screen += heading;
+        screen += "\033[0m\n";
+    }
+
+    /* Shows the screen until a number from 1 to count is entered; 0 once input has ended */
+    int ask(std::istream& in, std::ostream& out, size_t count) {
+        screen += "\033[35m[?] Enter your choice: ";
+        for (;;) {
+            out << screen << std::flush;
+            int choice = 0;
+            if (!(in >> choice)) {
+                if (in.eof())
+                    return 0;
+                in.clear();
+            }
+            in.ignore();
+            if (choice >= 1 && static_cast<size_t>(choice) <= count)
+                return choice;
+            out << "\033[31m[-] Invalid choice" << "\033[0m" << std::endl;
+        }
+    }
+
+public:
+    void clear() { targets.clear(); }
+
+    /* Starts a fight against the living entities */
+    void reset(const std::vector<std::shared_ptr<Entity>>& entities) {
+        targets.clear();
+        for (auto& entity : entities) {
+            if (entity->isAlive())
+                targets.push_back(entity);
+        }
+    }
+
+    void addTarget(std::shared_ptr<Entity> entity) {
+        if (entity->isAlive())
+            targets.push_back(std::move(entity));
+    }
+
+    /* Drops the targets that have died, keeping the order of the rest */
+    void removeDead() {
+        targets.erase(std::remove_if(targets.begin(), targets.end(),
+            [](const std::shared_ptr<Entity>& target) { return !target->isAlive(); }), targets.end());
+    }
+
+    size_t targetCount() const { return targets.size(); }
+    bool empty() const { return targets.empty(); }
+
+    /* FightAction as int, or 0 once input has ended */
+    int askAction(std::istream& in, std::ostream& out) {
+        beginScreen("[~] You are in a battle, choose an action:");
+        appendEntry(static_cast<int>(FightAction::ATTACK), "Attack");
+        appendEntry(static_cast<int>(FightAction::HEAL), "Heal");
+        appendEntry(static_cast<int>(FightAction::SHOW), "Show your data");
+        return ask(in, out, 3);
+    }
+
+    /* nullptr once input has ended */
+    Entity* askTarget(std::istream& in, std::ostream& out) {
+        beginScreen("[~] Choose who you will attack:");
+        int number = 0;
+        for (auto& target : targets) {
+            screen += "- ";
+            appendNumber(++number);
+            screen += '.';
+            screen += target->getName();
+            screen += " -> HP: ";
+            appendNumber(target->getHealth());
+            screen += '\n';
+        }
+        int choice = ask(in, out, targets.size());
+        return choice > 0 ? targets[choice - 1].get() : nullptr;
+    }
+};
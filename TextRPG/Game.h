@@ -1,11 +1,15 @@
 ﻿#pragma once
 #include "Scenario.h"
+#include "CombatLog.h"
 #include "Entity.h"
+#include "FightMenu.h"
 #include "Logger.h"
+#include "Random.h"
 #include <vector>
 #include <memory>
 #include <thread>
 #include <fstream>
+#include <iostream>
 
 class Game {
 private:
@@ -14,6 +18,13 @@ private:
     std::shared_ptr<Scenario> scenario = nullptr;
     std::shared_ptr<Character> player = nullptr;
     std::shared_ptr<std::vector<std::shared_ptr<Entity>>> entities = std::make_shared<std::vector<std::shared_ptr<Entity>>>();
+    FightMenu fightMenu;
+    // Every fight gets a generator of its own, seeded from the game seed and the fight number
+    uint64_t seed = Random::makeSeed();
+    uint32_t fightCount = 0;
+    uint64_t fightSeed = 0;
+    // What happens in a fight; shown after each turn, before the game pauses or asks
+    CombatLog combatLog{ std::make_shared<ConsoleCombatRenderer>() };
 
     std::shared_ptr<Logger<Game>> logger = std::make_shared<Logger<Game>>();
 public:
@@ -27,7 +38,25 @@ public:
 
     void setScenario(std::shared_ptr<Scenario> scenario) { this->scenario = scenario; }
     void setPlayer(std::shared_ptr<Character> player) { this->player = player; }
-    void addEntity(std::shared_ptr<Entity> entity) { entities->push_back(entity); }
+
+    /* Same seed and same answers give the same fights */
+    void setSeed(uint64_t value) {
+        seed = value;
+        fightCount = 0;
+    }
+    uint64_t getSeed() const { return seed; }
+    // Seed of the fight in progress or the last one; Random(getFightSeed()) plays it again
+    uint64_t getFightSeed() const { return fightSeed; }
+
+    /* Where fights are shown: ConsoleCombatRenderer by default, a FileCombatRenderer, or nullptr for nowhere */
+    void setCombatRenderer(std::shared_ptr<CombatRenderer> renderer) { combatLog.setRenderer(std::move(renderer)); }
+
+    void addEntity(std::shared_ptr<Entity> entity) {
+        entities->push_back(entity);
+        // Enemies spawned during a fight join it
+        if (*isFighting)
+            fightMenu.addTarget(entity);
+    }
 
     std::shared_ptr<Character> getPlayer() { return player; }
     bool inFight() { return *isFighting; }
@@ -44,67 +73,59 @@ public:
             return;
         }
 
-        logger->debug("Fight started");
+        fightSeed = Random(seed, fightCount++).getSeed();
+        Random random(fightSeed);
+        logger->debugf("Fight started with seed {}", fightSeed);
 
         *isFighting = true;
+        fightMenu.reset(*entities);
         while (*isFighting && !*isGameOverFlag) {
-            DialogueSystem* fightDialogueSystem = new DialogueSystem();
-
-            fightDialogueSystem->createNewDialogue("[~] You are in a battle, choose an action:");
-            fightDialogueSystem->createNewDialogue("[~] Choose who you will attack:");
-
-            fightDialogueSystem->setNextDialogue(fightDialogueSystem->getStartDialogue(), nullptr);
-            fightDialogueSystem->setNextDialogue(fightDialogueSystem->getEndDialogue(), nullptr);
-
-            fightDialogueSystem->addChoiceToDialogue("Attack", fightDialogueSystem->searchDialogue(1), 0);
-            fightDialogueSystem->addChoiceToDialogue("Heal", [&](void*) {
-                player->heal();
-                }, nullptr, 0);
-            fightDialogueSystem->addChoiceToDialogue("Show your data", [&](void*) {
-                player->display();
-                }, nullptr, 0);
-
-            for (auto& entity : *entities) {
-                if (!entity->isAlive())
-                    continue;
-                fightDialogueSystem->addChoiceToDialogue(
-                    entity->getName() + " -> HP: " + std::to_string(entity->getHealth()),
-                    [&](void*) {
-                        player->attack(*entity);
-                        if (!entity->isAlive())
-							return;
-                        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-                        entity->attack(*player);
-                    },
-                    nullptr, 1
-                );
+            if (fightMenu.empty()) {
+                combatLog.push(CombatEventType::VICTORY, player->getName());
+                logger->debug("Monsters defeated");
+                *isFighting = false;
+                break;
             }
 
-            fightDialogueSystem->execute(nullptr);
-            delete fightDialogueSystem;
-
-            bool hasAlive = false;
-            for (auto& entity : *entities) {
-                if (entity->isAlive()) {
-                    hasAlive = true;
-                    break;
+            combatLog.flush();
+            int action = fightMenu.askAction(std::cin, std::cout);
+            Entity* target = nullptr;
+            if (action == static_cast<int>(FightAction::ATTACK) && (target = fightMenu.askTarget(std::cin, std::cout)) == nullptr)
+                action = 0;
+
+            if (action == 0) {
+                // Input ended; the fight is still on and resumes from a save
+                logger->debug("Fight interrupted");
+                fightMenu.clear();
+                return;
+            }
+            else if (action == static_cast<int>(FightAction::ATTACK)) {
+                player->attack(*target, random, combatLog);
+                if (!target->isAlive()) {
+                    fightMenu.removeDead();
+                }
+                else {
+                    combatLog.flush();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                    target->attack(*player, random, combatLog);
                 }
             }
-
-            if (!hasAlive) {
-                std::cout << "\033[32m[~] Monsters defeated!\033[0m" << std::endl;
-                logger->debug("Monsters defeated");
-                *isFighting = false;
-                break;
+            else if (action == static_cast<int>(FightAction::HEAL)) {
+                player->heal(combatLog);
+            }
+            else if (action == static_cast<int>(FightAction::SHOW)) {
+                player->display();
             }
 
             if (!player->isAlive()) {
-                std::cout << "\033[31m[-] The player died from the injuries\033[0m" << std::endl;
+                combatLog.push(CombatEventType::DEFEAT, player->getName());
                 logger->debug("Player died");
                 *isGameOverFlag = true;
                 break;
             }
         }
+        combatLog.flush();
+        fightMenu.clear();
         entities->clear();
         logger->debug("Fight ended");
     }
@@ -140,6 +161,10 @@ public:
             logger->debug("Saving entity<" + std::to_string(entity->getId()) + ">");
             entity->save(file);
         }
+
+        // Last, so saves from before seeds still load
+        file.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+        file.write(reinterpret_cast<const char*>(&fightCount), sizeof(fightCount));
     }
 
     void load(const std::string& filename) {
@@ -179,5 +204,15 @@ public:
             entity->load(file);
             entities->push_back(entity);
         }
+
+        uint64_t savedSeed = 0;
+        uint32_t savedFightCount = 0;
+        file.read(reinterpret_cast<char*>(&savedSeed), sizeof(savedSeed));
+        file.read(reinterpret_cast<char*>(&savedFightCount), sizeof(savedFightCount));
+        if (file) {
+            seed = savedSeed;
+            fightCount = savedFightCount;
+        }
+        logger->debugf("Game seed {}, {} fights played", seed, fightCount);
     }
 };
\ No newline at end of file
@@ -121,21 +121,21 @@ public:
     }
 
     bool hasItem(const std::string& name) {
-        logger.debug("Check if item " + name + " is in inventory");
-        return std::find_if(items.begin(), items.end(), [&name](std::shared_ptr<Item> item) { return item->getName() == name; }) != items.end();
+        LOG_DEBUGF(logger, "Check if item {} is in inventory", name);
+        return std::find_if(items.begin(), items.end(), [&name](const std::shared_ptr<Item>& item) { return item->getName() == name; }) != items.end();
     }
 
     bool useItem(const std::string& item) {
         for (auto& it : items) {
             if (it->getName() == item) {
                 if (it->use()) {
-                    logger.debug("Used item: " + item);
+                    logger.debugf("Used item: {}", item);
                     return true;
                 }
                 break;
             }
         }
-        logger.debug("Item not found or cannot be used: " + item);
+        logger.debugf("Item not found or cannot be used: {}", item);
         return false;
     }
 
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/*
+ * Arguments of templated log calls are stored as tagged values rather than
+ * text: signed integers as zigzag varints, unsigned ones as varints, doubles
+ * as 8 raw bytes, strings with a varint length prefix. Turning them into
+ * text is left to whoever finally needs it (a text sink or the decoder).
+ */
+enum class LogArgType : uint8_t {
+    INT = 0,
+    UINT = 1,
+    DOUBLE = 2,
+    STRING = 3
+};
+
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline bool readVarint(const char*& data, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*data++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline bool readVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == EOF)
+            return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline void encodeSigned(std::string& out, long long value) {
+    out.push_back(static_cast<char>(LogArgType::INT));
+    uint64_t bits = static_cast<uint64_t>(value);
+    appendVarint(out, (bits << 1) ^ (value < 0 ? ~uint64_t(0) : 0));
+}
+
+inline void encodeUnsigned(std::string& out, unsigned long long value) {
+    out.push_back(static_cast<char>(LogArgType::UINT));
+    appendVarint(out, value);
+}
+
+inline void encodeString(std::string& out, const char* data, size_t size) {
+    out.push_back(static_cast<char>(LogArgType::STRING));
+    appendVarint(out, size);
+    out.append(data, size);
+}
+
+inline void encodeLogArg(std::string& out, signed char value) { encodeSigned(out, value); }
+inline void encodeLogArg(std::string& out, short value) { encodeSigned(out, value); }
+inline void encodeLogArg(std::string& out, int value) { encodeSigned(out, value); }
+inline void encodeLogArg(std::string& out, long value) { encodeSigned(out, value); }
+inline void encodeLogArg(std::string& out, long long value) { encodeSigned(out, value); }
+inline void encodeLogArg(std::string& out, unsigned char value) { encodeUnsigned(out, value); }
+inline void encodeLogArg(std::string& out, unsigned short value) { encodeUnsigned(out, value); }
+inline void encodeLogArg(std::string& out, unsigned int value) { encodeUnsigned(out, value); }
+inline void encodeLogArg(std::string& out, unsigned long value) { encodeUnsigned(out, value); }
+inline void encodeLogArg(std::string& out, unsigned long long value) { encodeUnsigned(out, value); }
+inline void encodeLogArg(std::string& out, bool value) { encodeUnsigned(out, value ? 1 : 0); }
+inline void encodeLogArg(std::string& out, char value) { encodeString(out, &value, 1); }
+inline void encodeLogArg(std::string& out, const char* value) { encodeString(out, value, std::strlen(value)); }
+inline void encodeLogArg(std::string& out, const std::string& value) { encodeString(out, value.data(), value.size()); }
+
+inline void encodeLogArg(std::string& out, double value) {
+    char bytes[sizeof(double)];
+    std::memcpy(bytes, &value, sizeof(double));
+    out.push_back(static_cast<char>(LogArgType::DOUBLE));
+    out.append(bytes, sizeof(double));
+}
+
+inline void encodeLogArg(std::string& out, float value) { encodeLogArg(out, static_cast<double>(value)); }
+
+inline void encodeLogArgs(std::string&) {}
+
+template <typename First, typename... Rest>
+void encodeLogArgs(std::string& out, const First& first, const Rest&... rest) {
+    encodeLogArg(out, first);
+    encodeLogArgs(out, rest...);
+}
+
+/* Writes the next argument as text; false if the payload is exhausted or corrupt */
+inline bool writeNextLogArg(std::ostream& out, const char*& data, const char* end) {
+    if (data >= end)
+        return false;
+
+    uint64_t value = 0;
+    switch (static_cast<LogArgType>(*data++)) {
+        case LogArgType::INT:
+            if (!readVarint(data, end, value))
+                return false;
+            out << static_cast<long long>((value >> 1) ^ (~(value & 1) + 1));
+            return true;
+        case LogArgType::UINT:
+            if (!readVarint(data, end, value))
+                return false;
+            out << static_cast<unsigned long long>(value);
+            return true;
+        case LogArgType::DOUBLE: {
+            if (end - data < static_cast<ptrdiff_t>(sizeof(double)))
+                return false;
+            double number;
+            std::memcpy(&number, data, sizeof(double));
+            data += sizeof(double);
+            out << number;
+            return true;
+        }
+        case LogArgType::STRING:
+            if (!readVarint(data, end, value) || value > static_cast<uint64_t>(end - data))
+                return false;
+            out.write(data, static_cast<std::streamsize>(value));
+            data += value;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Substitutes each "{}" in format with the next encoded argument */
+inline void renderLogTemplate(std::ostream& out, const char* format, const char* data, const char* end) {
+    const char* text = format;
+    for (const char* p = format; *p; ++p) {
+        if (p[0] != '{' || p[1] != '}')
+            continue;
+        out.write(text, p - text);
+        if (!writeNextLogArg(out, data, end))
+            out << "{}";
+        ++p;
+        text = p + 1;
+    }
+    out << text;
+}
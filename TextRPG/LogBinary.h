@@ -0,0 +1,209 @@
+#pragma once
+#include "LogRecord.h"
+#include "LogArgs.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class LogFormat {
+    TEXT,
+    BINARY
+};
+
+/*
+ * Binary log layout. Every writer session starts with a SESSION frame; the
+ * logger-name and template dictionaries are local to a session, so files
+ * appended to across several runs still decode. Numbers are varints.
+ *
+ *   SESSION  'S' "TRPGLOG" version:u8
+ *   LOGGER   'L' id len bytes
+ *   TEMPLATE 'T' id len bytes
+ *   RECORD   'R' level:u8 timestamp monotonicNs loggerId templateId len args
+ *
+ * Template id 0 is the implicit "{}" used for plain string messages.
+ */
+enum class LogFrameType : char {
+    SESSION = 'S',
+    LOGGER = 'L',
+    TEMPLATE = 'T',
+    RECORD = 'R'
+};
+
+const uint8_t logBinaryVersion = 1;
+
+// Longest string a frame may carry when the decoder cannot tell how much input is left
+const uint64_t logBinaryMaxBytes = 16 * 1024 * 1024;
+
+inline const char* logBinaryMagic() { return "TRPGLOG"; }
+
+class LogBinaryEncoder {
+private:
+    std::unordered_map<std::string, uint64_t> loggerIds;
+    std::unordered_map<std::string, uint64_t> templateIds;
+    // Templates are string literals, so their address is a cheap first-level key
+    std::unordered_map<const char*, uint64_t> templateAddresses;
+    std::string frame;
+    bool sessionStarted = false;
+
+    uint64_t intern(std::ostream& out, std::unordered_map<std::string, uint64_t>& ids, LogFrameType type, const std::string& text) {
+        auto found = ids.find(text);
+        if (found != ids.end())
+            return found->second;
+
+        uint64_t id = ids.size() + 1;
+        ids.emplace(text, id);
+        frame.clear();
+        frame.push_back(static_cast<char>(type));
+        appendVarint(frame, id);
+        appendVarint(frame, text.size());
+        frame.append(text);
+        out.write(frame.data(), frame.size());
+        return id;
+    }
+
+    uint64_t internTemplate(std::ostream& out, const char* format) {
+        auto found = templateAddresses.find(format);
+        if (found != templateAddresses.end())
+            return found->second;
+        uint64_t id = intern(out, templateIds, LogFrameType::TEMPLATE, format);
+        templateAddresses.emplace(format, id);
+        return id;
+    }
+
+public:
+    void write(std::ostream& out, const LogRecord& record, const std::string& loggerName) {
+        if (!sessionStarted) {
+            out.put(static_cast<char>(LogFrameType::SESSION));
+            out.write(logBinaryMagic(), 7);
+            out.put(static_cast<char>(logBinaryVersion));
+            sessionStarted = true;
+        }
+
+        uint64_t loggerId = intern(out, loggerIds, LogFrameType::LOGGER, loggerName);
+        uint64_t templateId = record.format ? internTemplate(out, record.format) : 0;
+
+        frame.clear();
+        frame.push_back(static_cast<char>(LogFrameType::RECORD));
+        frame.push_back(static_cast<char>(record.level));
+        appendVarint(frame, static_cast<uint64_t>(record.timestamp));
+        appendVarint(frame, static_cast<uint64_t>(record.monotonicNs));
+        appendVarint(frame, loggerId);
+        appendVarint(frame, templateId);
+        if (record.format) {
+            appendVarint(frame, record.message.size());
+            frame.append(record.message);
+        }
+        else {
+            appendVarint(frame, 1 + varintSize(record.message.size()) + record.message.size());
+            encodeString(frame, record.message.data(), record.message.size());
+        }
+        out.write(frame.data(), frame.size());
+    }
+};
+
+/* Reads frames back and prints them in the same layout as text sinks */
+class LogBinaryDecoder {
+private:
+    std::vector<std::string> loggerNames;
+    std::vector<std::string> templates;
+    std::string error;
+
+    /* Bytes left in the input, or logBinaryMaxBytes if it cannot seek */
+    static uint64_t remaining(std::istream& in) {
+        std::streampos here = in.tellg();
+        if (here == std::streampos(-1))
+            return logBinaryMaxBytes;
+        in.seekg(0, std::ios::end);
+        std::streampos end = in.tellg();
+        in.seekg(here);
+        return end > here ? static_cast<uint64_t>(end - here) : 0;
+    }
+
+    /* A length past the end of the input is a damaged frame, not a reason to allocate it */
+    static bool readBytes(std::istream& in, std::string& bytes) {
+        uint64_t size = 0;
+        if (!readVarint(in, size) || size > remaining(in))
+            return false;
+        bytes.resize(static_cast<size_t>(size));
+        return size == 0 || in.read(&bytes[0], static_cast<std::streamsize>(size));
+    }
+
+    bool define(std::istream& in, std::vector<std::string>& table) {
+        uint64_t id = 0;
+        std::string text;
+        if (!readVarint(in, id) || id == 0 || !readBytes(in, text)) {
+            error = "truncated definition frame";
+            return false;
+        }
+        // Ids are handed out in order, so a new one is at most one past the table
+        if (id > (table.empty() ? 1 : table.size())) {
+            error = "definition skips ids";
+            return false;
+        }
+        if (table.size() <= id)
+            table.resize(static_cast<size_t>(id) + 1);
+        table[static_cast<size_t>(id)] = text;
+        return true;
+    }
+
+public:
+    const std::string& getError() const { return error; }
+
+    /* Returns false at end of input or on a malformed frame (see getError) */
+    bool next(std::istream& in, std::ostream& out) {
+        for (;;) {
+            int type = in.get();
+            if (type == EOF)
+                return false;
+
+            if (type == static_cast<char>(LogFrameType::SESSION)) {
+                char magic[7];
+                if (!in.read(magic, 7) || std::memcmp(magic, logBinaryMagic(), 7) != 0) {
+                    error = "bad session header";
+                    return false;
+                }
+                if (in.get() != logBinaryVersion) {
+                    error = "unsupported version";
+                    return false;
+                }
+                loggerNames.clear();
+                templates.clear();
+            }
+            else if (type == static_cast<char>(LogFrameType::LOGGER)) {
+                if (!define(in, loggerNames))
+                    return false;
+            }
+            else if (type == static_cast<char>(LogFrameType::TEMPLATE)) {
+                if (!define(in, templates))
+                    return false;
+            }
+            else if (type == static_cast<char>(LogFrameType::RECORD)) {
+                LogRecord record { LogLevel::DEBUG, std::string(), 0 };
+                uint64_t timestamp = 0, monotonic = 0, loggerId = 0, templateId = 0;
+                int level = in.get();
+                if (level == EOF || !readVarint(in, timestamp) || !readVarint(in, monotonic)
+                    || !readVarint(in, loggerId) || !readVarint(in, templateId) || !readBytes(in, record.message)) {
+                    error = "truncated record frame";
+                    return false;
+                }
+                if (loggerId >= loggerNames.size() || (templateId != 0 && templateId >= templates.size())) {
+                    error = "record references an undefined id";
+                    return false;
+                }
+                record.level = static_cast<LogLevel>(level);
+                record.timestamp = static_cast<time_t>(timestamp);
+                record.monotonicNs = static_cast<int64_t>(monotonic);
+                record.format = templateId == 0 ? "{}" : templates[static_cast<size_t>(templateId)].c_str();
+                writeRecordLine(out, record, loggerNames[static_cast<size_t>(loggerId)]);
+                return true;
+            }
+            else {
+                error = "unknown frame type";
+                return false;
+            }
+        }
+    }
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "LogArgs.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Small LZ77 codec for rotated log segments. Logs repeat the same prefixes
+ * and templates on every line, so plain back-references already shrink them
+ * several times without pulling in a compression library.
+ *
+ *   "TRLZ" originalSize { literalCount literals offset [matchLength - 4] }
+ *
+ * An offset of 0 ends the stream.
+ */
+inline const char* logCompressionMagic() { return "TRLZ"; }
+
+inline std::string compressLog(const std::string& input) {
+    const size_t minMatch = 4;
+    const size_t maxOffset = 65535;
+    const int hashBits = 14;
+
+    std::string out(logCompressionMagic());
+    appendVarint(out, input.size());
+
+    std::vector<size_t> table(size_t(1) << hashBits, static_cast<size_t>(-1));
+    const char* data = input.data();
+    size_t size = input.size();
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (pos + minMatch <= size) {
+        uint32_t sequence;
+        std::memcpy(&sequence, data + pos, sizeof(sequence));
+        size_t hash = (sequence * 2654435761u) >> (32 - hashBits);
+        size_t candidate = table[hash];
+        table[hash] = pos;
+
+        if (candidate == static_cast<size_t>(-1) || pos - candidate > maxOffset
+            || std::memcmp(data + candidate, data + pos, minMatch) != 0) {
+            ++pos;
+            continue;
+        }
+
+        size_t length = minMatch;
+        while (pos + length < size && data[candidate + length] == data[pos + length])
+            ++length;
+
+        appendVarint(out, pos - anchor);
+        out.append(data + anchor, pos - anchor);
+        appendVarint(out, pos - candidate);
+        appendVarint(out, length - minMatch);
+
+        pos += length;
+        anchor = pos;
+    }
+
+    appendVarint(out, size - anchor);
+    out.append(data + anchor, size - anchor);
+    appendVarint(out, 0);
+    return out;
+}
+
+inline bool isCompressedLog(const std::string& input) {
+    return input.compare(0, 4, logCompressionMagic()) == 0;
+}
+
+inline std::string decompressLog(const std::string& input) {
+    if (!isCompressedLog(input))
+        throw std::runtime_error("Not a compressed log segment");
+
+    const char* data = input.data() + 4;
+    const char* end = input.data() + input.size();
+    uint64_t size = 0;
+    if (!readVarint(data, end, size))
+        throw std::runtime_error("Corrupt compressed log segment");
+
+    // The header is not trusted: every run is checked against it, and it only
+    // sizes the buffer up to what the input could plausibly expand to
+    std::string out;
+    out.reserve(static_cast<size_t>(std::min<uint64_t>(size, uint64_t(input.size()) * 8)));
+    for (;;) {
+        uint64_t literals = 0, offset = 0, length = 0;
+        if (!readVarint(data, end, literals) || literals > static_cast<uint64_t>(end - data)
+            || literals > size - out.size())
+            throw std::runtime_error("Corrupt compressed log segment");
+        out.append(data, static_cast<size_t>(literals));
+        data += literals;
+
+        if (!readVarint(data, end, offset))
+            throw std::runtime_error("Corrupt compressed log segment");
+        if (offset == 0)
+            break;
+        if (!readVarint(data, end, length) || offset > out.size()
+            || size - out.size() < 4 || length > size - out.size() - 4)
+            throw std::runtime_error("Corrupt compressed log segment");
+
+        size_t from = out.size() - static_cast<size_t>(offset);
+        for (uint64_t i = 0; i < length + 4; ++i)
+            out.push_back(out[from + static_cast<size_t>(i)]);
+    }
+
+    if (out.size() != size)
+        throw std::runtime_error("Corrupt compressed log segment");
+    return out;
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include "LogRecord.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct LogHistoryEntry {
+    LogRecord record;
+    std::string loggerName;
+    // When it was pushed, to merge the threads' rings in order
+    int64_t pushedNs = 0;
+};
+
+/*
+ * The most recent records of every Logger, capacity of them per thread.
+ * Each thread writes to a ring of its own, so logging threads never wait
+ * for each other; the rings are only merged when the history is read.
+ * Slots are overwritten in place, so memory stays flat however long the
+ * game runs. Rings of finished threads are folded into a retired ring.
+ */
+class LogHistory {
+private:
+    // Only its owner pushes, so the mutex is contended only while the history is read
+    struct ThreadRing {
+        std::vector<LogHistoryEntry> slots;
+        size_t next = 0;
+        size_t count = 0;
+        std::mutex ringMutex;
+
+        explicit ThreadRing(size_t capacity) : slots(capacity) {}
+
+        void resize(size_t capacity) {
+            std::vector<LogHistoryEntry>(capacity).swap(slots);
+            next = 0;
+            count = 0;
+        }
+
+        void push(const LogRecord& record, const std::string& loggerName, int64_t pushedNs) {
+            if (slots.empty())
+                return;
+            LogHistoryEntry& slot = slots[next];
+            slot.record.level = record.level;
+            slot.record.message.assign(record.message);
+            slot.record.timestamp = record.timestamp;
+            slot.record.monotonicNs = record.monotonicNs;
+            slot.record.format = record.format;
+            slot.loggerName.assign(loggerName);
+            slot.pushedNs = pushedNs;
+            next = (next + 1) % slots.size();
+            if (count < slots.size())
+                ++count;
+        }
+
+        /* Oldest first */
+        void appendTo(std::vector<LogHistoryEntry>& entries) const {
+            for (size_t i = 0; i < count; ++i)
+                entries.push_back(slots[(next + slots.size() - count + i) % slots.size()]);
+        }
+    };
+
+    // Detaches the thread's ring when the thread exits
+    struct ThreadSlot {
+        ~ThreadSlot() { LogHistory::instance().detach(currentRing()); }
+    };
+
+    std::vector<ThreadRing*> rings;
+    // Finished threads, and anything logged after a thread's slot is gone
+    ThreadRing retired;
+    size_t capacity;
+    std::mutex ringsMutex;
+
+    LogHistory() : retired(256), capacity(256) {}
+
+    static ThreadRing*& currentRing() {
+        thread_local ThreadRing* ring = nullptr;
+        return ring;
+    }
+
+    ThreadRing& local() {
+        ThreadRing*& ring = currentRing();
+        if (!ring) {
+            thread_local ThreadSlot slot;
+            (void)slot;
+            ring = attach();
+        }
+        return *ring;
+    }
+
+    ThreadRing* attach() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(new ThreadRing(capacity));
+        return rings.back();
+    }
+
+    void detach(ThreadRing*& ring) {
+        if (!ring || ring == &retired)
+            return;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        std::vector<LogHistoryEntry> entries;
+        {
+            std::lock_guard<std::mutex> ringLock(ring->ringMutex);
+            ring->appendTo(entries);
+        }
+        {
+            std::lock_guard<std::mutex> retiredLock(retired.ringMutex);
+            for (auto& entry : entries)
+                retired.push(entry.record, entry.loggerName, entry.pushedNs);
+        }
+        for (size_t i = 0; i < rings.size(); ++i) {
+            if (rings[i] == ring) {
+                rings[i] = rings.back();
+                rings.pop_back();
+                break;
+            }
+        }
+        delete ring;
+        ring = &retired;
+    }
+
+public:
+    LogHistory(const LogHistory&) = delete;
+    LogHistory& operator=(const LogHistory&) = delete;
+
+    ~LogHistory() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto ring : rings)
+            delete ring;
+        rings.clear();
+    }
+
+    static LogHistory& instance() {
+        static LogHistory history;
+        return history;
+    }
+
+    /* Records kept per thread; resizing forgets what was stored, 0 disables the history */
+    void setCapacity(size_t value) {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        capacity = value;
+        for (auto ring : rings) {
+            std::lock_guard<std::mutex> ringLock(ring->ringMutex);
+            ring->resize(capacity);
+        }
+        std::lock_guard<std::mutex> retiredLock(retired.ringMutex);
+        retired.resize(capacity);
+    }
+
+    size_t getCapacity() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        return capacity;
+    }
+
+    /* pushedNs orders records of different threads when they are merged */
+    void push(const LogRecord& record, const std::string& loggerName, int64_t pushedNs) {
+        ThreadRing& ring = local();
+        std::lock_guard<std::mutex> lock(ring.ringMutex);
+        ring.push(record, loggerName, pushedNs);
+    }
+
+    /* Oldest first, over all threads */
+    std::vector<LogHistoryEntry> last(size_t n) {
+        std::vector<LogHistoryEntry> entries;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (auto ring : rings) {
+                std::lock_guard<std::mutex> ringLock(ring->ringMutex);
+                ring->appendTo(entries);
+            }
+            std::lock_guard<std::mutex> retiredLock(retired.ringMutex);
+            retired.appendTo(entries);
+        }
+        std::stable_sort(entries.begin(), entries.end(), [](const LogHistoryEntry& a, const LogHistoryEntry& b) {
+            return a.pushedNs < b.pushedNs;
+        });
+        if (n < entries.size())
+            entries.erase(entries.begin(), entries.end() - n);
+        return entries;
+    }
+
+    void dump(std::ostream& out, size_t n = static_cast<size_t>(-1)) {
+        for (auto& entry : last(n))
+            writeRecordLine(out, entry.record, entry.loggerName);
+        out.flush();
+    }
+};
@@ -0,0 +1,245 @@
+#pragma once
+#include "LogRecord.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const size_t logLevelCount = 5;
+const size_t logLatencyBuckets = 32;
+
+/*
+ * Totals over every thread. Bucket i of latency counts log() calls that took
+ * less than 2^i ns (and at least 2^(i-1) ns); the last bucket is open-ended.
+ */
+struct LogMetricsSnapshot {
+    uint64_t records[logLevelCount] = {};
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    uint64_t suppressed = 0;
+    uint64_t latency[logLatencyBuckets] = {};
+    uint64_t latencyNs = 0;
+
+    uint64_t totalRecords() const {
+        uint64_t total = 0;
+        for (uint64_t count : records)
+            total += count;
+        return total;
+    }
+
+    /* Upper bound in ns under which the given fraction of calls finished */
+    uint64_t latencyPercentile(double fraction) const {
+        uint64_t total = 0;
+        for (uint64_t count : latency)
+            total += count;
+        if (total == 0)
+            return 0;
+        uint64_t target = static_cast<uint64_t>(fraction * total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < logLatencyBuckets; ++i) {
+            seen += latency[i];
+            if (seen > target || seen == total)
+                return uint64_t(1) << i;
+        }
+        return uint64_t(1) << (logLatencyBuckets - 1);
+    }
+
+    /* What happened between earlier and this snapshot, e.g. over one fight turn */
+    LogMetricsSnapshot since(const LogMetricsSnapshot& earlier) const {
+        LogMetricsSnapshot delta = *this;
+        for (size_t i = 0; i < logLevelCount; ++i)
+            delta.records[i] -= earlier.records[i];
+        delta.bytes -= earlier.bytes;
+        delta.dropped -= earlier.dropped;
+        delta.suppressed -= earlier.suppressed;
+        for (size_t i = 0; i < logLatencyBuckets; ++i)
+            delta.latency[i] -= earlier.latency[i];
+        delta.latencyNs -= earlier.latencyNs;
+        return delta;
+    }
+
+    void write(std::ostream& out) const {
+        uint64_t total = totalRecords();
+        out << "records " << total;
+        for (size_t i = 0; i < logLevelCount; ++i)
+            out << ' ' << levelToString(static_cast<LogLevel>(i)) << '=' << records[i];
+        out << ", bytes " << bytes << ", dropped " << dropped << ", suppressed " << suppressed
+            << ", log() avg " << (total ? latencyNs / total : 0) << "ns p50<" << latencyPercentile(0.5)
+            << "ns p99<" << latencyPercentile(0.99) << "ns max<" << latencyPercentile(1.0) << "ns";
+    }
+};
+
+/*
+ * Logging self-metrics. Each thread bumps counters in its own block, so the
+ * hot path never shares a cache line; snapshot() sums the blocks, and blocks
+ * of finished threads are folded into a retired total.
+ */
+class LogMetrics {
+private:
+    struct ThreadBlock {
+        std::atomic<uint64_t> records[logLevelCount];
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<uint64_t> suppressed{ 0 };
+        std::atomic<uint64_t> latency[logLatencyBuckets];
+        std::atomic<uint64_t> latencyNs{ 0 };
+
+        ThreadBlock() {
+            for (auto& count : records)
+                count.store(0, std::memory_order_relaxed);
+            for (auto& count : latency)
+                count.store(0, std::memory_order_relaxed);
+        }
+
+        void addTo(LogMetricsSnapshot& snapshot) const {
+            for (size_t i = 0; i < logLevelCount; ++i)
+                snapshot.records[i] += records[i].load(std::memory_order_relaxed);
+            snapshot.bytes += bytes.load(std::memory_order_relaxed);
+            snapshot.dropped += dropped.load(std::memory_order_relaxed);
+            snapshot.suppressed += suppressed.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < logLatencyBuckets; ++i)
+                snapshot.latency[i] += latency[i].load(std::memory_order_relaxed);
+            snapshot.latencyNs += latencyNs.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Detaches the thread's block when the thread exits
+    struct ThreadSlot {
+        ~ThreadSlot() { LogMetrics::instance().detach(currentBlock()); }
+    };
+
+    std::vector<ThreadBlock*> blocks;
+    // Finished threads, and anything logged after a thread's slot is gone
+    ThreadBlock retired;
+    std::mutex blocksMutex;
+
+    std::thread dumper;
+    bool dumpStopping = false;
+    std::mutex dumpMutex;
+    std::condition_variable dumpCondition;
+
+    LogMetrics() {}
+
+    static ThreadBlock*& currentBlock() {
+        thread_local ThreadBlock* block = nullptr;
+        return block;
+    }
+
+    static ThreadBlock& local() {
+        ThreadBlock*& block = currentBlock();
+        if (!block) {
+            thread_local ThreadSlot slot;
+            (void)slot;
+            block = instance().attach();
+        }
+        return *block;
+    }
+
+    ThreadBlock* attach() {
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        blocks.push_back(new ThreadBlock());
+        return blocks.back();
+    }
+
+    void detach(ThreadBlock*& block) {
+        if (!block || block == &retired)
+            return;
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        LogMetricsSnapshot totals;
+        block->addTo(totals);
+        for (size_t i = 0; i < logLevelCount; ++i)
+            retired.records[i].fetch_add(totals.records[i], std::memory_order_relaxed);
+        retired.bytes.fetch_add(totals.bytes, std::memory_order_relaxed);
+        retired.dropped.fetch_add(totals.dropped, std::memory_order_relaxed);
+        retired.suppressed.fetch_add(totals.suppressed, std::memory_order_relaxed);
+        for (size_t i = 0; i < logLatencyBuckets; ++i)
+            retired.latency[i].fetch_add(totals.latency[i], std::memory_order_relaxed);
+        retired.latencyNs.fetch_add(totals.latencyNs, std::memory_order_relaxed);
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blocks[i] == block) {
+                blocks[i] = blocks.back();
+                blocks.pop_back();
+                break;
+            }
+        }
+        delete block;
+        block = &retired;
+    }
+
+    void runDump(std::chrono::milliseconds interval, std::string path) {
+        std::unique_lock<std::mutex> lock(dumpMutex);
+        while (!dumpCondition.wait_for(lock, interval, [this] { return dumpStopping; })) {
+            std::ofstream out(path, std::ios::app);
+            out << formatTimestamp(std::time(nullptr)) << ' ';
+            snapshot().write(out);
+            out << '\n';
+        }
+    }
+
+public:
+    LogMetrics(const LogMetrics&) = delete;
+    LogMetrics& operator=(const LogMetrics&) = delete;
+
+    ~LogMetrics() {
+        stopDump();
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        for (auto block : blocks)
+            delete block;
+        blocks.clear();
+    }
+
+    static LogMetrics& instance() {
+        static LogMetrics metrics;
+        return metrics;
+    }
+
+    /* Owner-thread counters: relaxed adds on a line no other thread writes */
+    static void recordLog(LogLevel level, int64_t elapsedNs) {
+        ThreadBlock& block = local();
+        uint64_t ns = elapsedNs > 0 ? static_cast<uint64_t>(elapsedNs) : 0;
+        size_t bucket = 0;
+        while (bucket + 1 < logLatencyBuckets && (ns >> bucket) != 0)
+            ++bucket;
+        block.records[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+        block.latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        block.latencyNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    static void recordBytes(uint64_t bytes) { local().bytes.fetch_add(bytes, std::memory_order_relaxed); }
+    static void recordDropped() { local().dropped.fetch_add(1, std::memory_order_relaxed); }
+    static void recordSuppressed() { local().suppressed.fetch_add(1, std::memory_order_relaxed); }
+
+    LogMetricsSnapshot snapshot() {
+        LogMetricsSnapshot totals;
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        retired.addTo(totals);
+        for (auto block : blocks)
+            block->addTo(totals);
+        return totals;
+    }
+
+    /* Appends one snapshot line to path every interval until stopDump() */
+    void startDump(std::chrono::milliseconds interval, const std::string& path) {
+        stopDump();
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        dumpStopping = false;
+        dumper = std::thread(&LogMetrics::runDump, this, interval, path);
+    }
+
+    void stopDump() {
+        {
+            std::lock_guard<std::mutex> lock(dumpMutex);
+            dumpStopping = true;
+        }
+        dumpCondition.notify_one();
+        if (dumper.joinable())
+            dumper.join();
+    }
+};
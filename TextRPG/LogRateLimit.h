@@ -0,0 +1,117 @@
+#pragma once
+#include "LogRecord.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+/* Per-logger limits applied to LOG_* call sites; 0 / 1 mean unlimited */
+struct LogLimits {
+    uint32_t perSecond = 0;
+    uint32_t debugSampling = 1;
+
+    bool enabled() const { return perSecond > 0 || debugSampling > 1; }
+};
+
+/*
+ * State of one LOG_* call site. The constructor is constexpr, so the static
+ * the macro declares is constant-initialised and needs no guard on every hit.
+ * There is one per macro line, not per logger: every Logger that logs
+ * through the line shares its window and suppressed count, and each hit is
+ * judged by the limits of the logger making it.
+ */
+struct LogSite {
+    const char* file;
+    int line;
+    std::atomic<int64_t> windowSecond;
+    std::atomic<uint32_t> windowCount;
+    std::atomic<uint64_t> sampleCount;
+    std::atomic<uint64_t> suppressed;
+    // Level of the latest suppressed hit, for reports made away from the site
+    std::atomic<int> suppressedLevel;
+    // Set once the site is on the suppressingLogSites list
+    std::atomic<bool> listed;
+    LogSite* nextListed;
+
+    constexpr LogSite(const char* file, int line)
+        : file(file), line(line), windowSecond(0), windowCount(0), sampleCount(0), suppressed(0),
+        suppressedLevel(0), listed(false), nextListed(nullptr) {}
+
+    const char* fileName() const {
+        const char* name = file;
+        for (const char* p = file; *p; ++p) {
+            if (*p == '/' || *p == '\\')
+                name = p + 1;
+        }
+        return name;
+    }
+};
+
+/* Every site that has suppressed something; sites are statics, so entries are never removed */
+inline std::atomic<LogSite*>& suppressingLogSites() {
+    static std::atomic<LogSite*> head{ nullptr };
+    return head;
+}
+
+inline void suppressLogSite(LogSite& site, LogLevel level) {
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    site.suppressedLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    if (site.listed.load(std::memory_order_relaxed) || site.listed.exchange(true, std::memory_order_relaxed))
+        return;
+    std::atomic<LogSite*>& head = suppressingLogSites();
+    LogSite* first = head.load(std::memory_order_relaxed);
+    do {
+        site.nextListed = first;
+    } while (!head.compare_exchange_weak(first, &site, std::memory_order_release, std::memory_order_relaxed));
+}
+
+/*
+ * Hands report(site, level, count) the counts suppressed at sites whose
+ * window has ended without another hit to report them, or at every site
+ * when all is set (at shutdown). A count is taken by exactly one of this
+ * and admitLogSite.
+ */
+template <typename Report>
+void sweepSuppressedLogSites(bool all, Report report) {
+    int64_t second = static_cast<int64_t>(std::time(nullptr));
+    for (LogSite* site = suppressingLogSites().load(std::memory_order_acquire); site; site = site->nextListed) {
+        if (!all && site->windowSecond.load(std::memory_order_relaxed) >= second)
+            continue;
+        uint64_t count = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if (count > 0)
+            report(*site, static_cast<LogLevel>(site->suppressedLevel.load(std::memory_order_relaxed)), count);
+    }
+}
+
+/*
+ * Decides whether a hit on site may be logged. DEBUG hits are sampled 1 in
+ * debugSampling, then every level is capped at perSecond per site. When a new
+ * second starts, the count suppressed during the previous ones is moved into
+ * report so the caller can log it once. Sites that go quiet are reported by
+ * AsyncLogWriter instead (sweepSuppressedLogSites).
+ */
+inline bool admitLogSite(LogSite& site, LogLevel level, const LogLimits& limits, uint64_t& report) {
+    report = 0;
+    if (!limits.enabled())
+        return true;
+
+    int64_t second = static_cast<int64_t>(std::time(nullptr));
+    int64_t window = site.windowSecond.load(std::memory_order_relaxed);
+    // Only move forward: a thread holding an older reading must not reopen a past window
+    if (second > window && site.windowSecond.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        site.windowCount.store(0, std::memory_order_relaxed);
+        report = site.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (level == LogLevel::DEBUG && limits.debugSampling > 1
+        && site.sampleCount.fetch_add(1, std::memory_order_relaxed) % limits.debugSampling != 0) {
+        suppressLogSite(site, level);
+        return false;
+    }
+
+    if (limits.perSecond > 0 && site.windowCount.fetch_add(1, std::memory_order_relaxed) >= limits.perSecond) {
+        suppressLogSite(site, level);
+        return false;
+    }
+    return true;
+}
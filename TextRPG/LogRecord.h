@@ -0,0 +1,147 @@
+#pragma once
+#include "LogArgs.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <ostream>
+#include <ctime>
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR,
+    CRITICAL
+};
+
+struct LogRecord {
+    LogLevel level;
+    std::string message;
+    time_t timestamp;
+    int64_t monotonicNs = 0;
+    // Set for templated calls: message then holds the encoded arguments
+    const char* format = nullptr;
+};
+
+/*
+ * Reused by every Logger call on this thread, so the message keeps its
+ * capacity. The main thread's copy is destroyed before globals such as the
+ * Game are, so their destructors log into a record built in storage that is
+ * never destroyed. Only its last message outlives the thread, and the short
+ * ones logged at exit fit in the string itself.
+ */
+inline LogRecord& threadLogRecord() {
+    struct Slot {
+        LogRecord record{ LogLevel::DEBUG, std::string(), 0 };
+        bool& released;
+        explicit Slot(bool& released) : released(released) {}
+        ~Slot() { released = true; }
+    };
+    // Trivially destructible, so still readable after the slot is gone
+    thread_local bool released = false;
+    thread_local Slot slot(released);
+    if (released) {
+        thread_local std::aligned_storage<sizeof(LogRecord), alignof(LogRecord)>::type leftover;
+        thread_local bool built = false;
+        if (!built) {
+            new (&leftover) LogRecord{ LogLevel::DEBUG, std::string(), 0 };
+            built = true;
+        }
+        return *reinterpret_cast<LogRecord*>(&leftover);
+    }
+    return slot.record;
+}
+
+inline const char* levelToString(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARNING: return "WARNING";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::CRITICAL: return "CRITICAL";
+        default: return "UNKNOWN";
+    }
+}
+
+inline const char* colorizeLevel(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "\033[0m";
+        case LogLevel::INFO: return "\033[34m";
+        case LogLevel::WARNING: return "\033[33m";
+        case LogLevel::ERROR: return "\033[31m";
+        case LogLevel::CRITICAL: return "\033[35m";
+        default: return "\033[0m";
+    }
+}
+
+inline bool toLocalTime(time_t timestamp, struct tm& timeInfo) {
+#ifdef _WIN32
+    return localtime_s(&timeInfo, &timestamp) == 0;
+#else
+    return localtime_r(&timestamp, &timeInfo) != nullptr;
+#endif
+}
+
+/* Per-thread "YYYY-MM-DD HH:MM:SS", reformatted only when the second changes */
+inline const char* formatTimestamp(time_t timestamp) {
+    struct Cache {
+        time_t second = static_cast<time_t>(-1);
+        char text[20] = "";
+    };
+    static thread_local Cache cache;
+
+    if (cache.second != timestamp) {
+        struct tm timeInfo;
+        if (!toLocalTime(timestamp, timeInfo) || strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &timeInfo) == 0)
+            cache.text[0] = '\0';
+        cache.second = timestamp;
+    }
+    return cache.text;
+}
+
+inline std::chrono::steady_clock::time_point logClockStart() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+inline int64_t monotonicNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - logClockStart()).count();
+}
+
+inline std::atomic<bool>& subSecondTimestampsFlag() {
+    static std::atomic<bool> flag{ false };
+    return flag;
+}
+
+/* Adds "+seconds.micros" since logging started after the wall-clock time */
+inline void setSubSecondTimestamps(bool value) { subSecondTimestampsFlag().store(value, std::memory_order_relaxed); }
+inline bool subSecondTimestamps() { return subSecondTimestampsFlag().load(std::memory_order_relaxed); }
+
+inline void writeRecordPrefix(std::ostream& out, const LogRecord& record, const std::string& loggerName) {
+    out << formatTimestamp(record.timestamp);
+    if (subSecondTimestamps()) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), " +%lld.%06lld",
+            static_cast<long long>(record.monotonicNs / 1000000000),
+            static_cast<long long>(record.monotonicNs % 1000000000 / 1000));
+        out << buffer;
+    }
+    out << " [" << levelToString(record.level) << "] (" << loggerName << ") ";
+}
+
+inline void writeRecordMessage(std::ostream& out, const LogRecord& record) {
+    if (record.format)
+        renderLogTemplate(out, record.format, record.message.data(), record.message.data() + record.message.size());
+    else
+        out << record.message;
+}
+
+inline void writeRecordLine(std::ostream& out, const LogRecord& record, const std::string& loggerName) {
+    writeRecordPrefix(out, record, loggerName);
+    writeRecordMessage(out, record);
+    out << '\n';
+}
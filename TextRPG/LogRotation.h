@@ -0,0 +1,198 @@
+#pragma once
+#include "LogCompression.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+struct LogRotationPolicy {
+    // 0 disables the corresponding limit
+    uint64_t maxBytes = 0;
+    std::chrono::seconds maxAge{ 0 };
+    size_t maxSegments = 0;
+    uint64_t maxTotalBytes = 0;
+    bool compress = true;
+
+    bool enabled() const { return maxBytes > 0 || maxAge.count() > 0; }
+};
+
+inline uint64_t fileSize(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return 0;
+    std::streamoff size = file.tellg();
+    return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+/*
+ * Rotated segments of one log file, oldest first. The list is persisted in
+ * "<path>.segments" so retention keeps working across restarts without
+ * scanning the directory.
+ */
+class LogArchive {
+private:
+    struct Segment {
+        std::string path;
+        uint64_t bytes;
+        bool pending;
+    };
+
+    std::string logPath;
+    LogRotationPolicy policy;
+    std::deque<Segment> segments;
+    uint64_t nextIndex = 1;
+    std::mutex archiveMutex;
+
+    std::string manifestPath() const { return logPath + ".segments"; }
+
+    void saveLocked() {
+        std::ofstream manifest(manifestPath(), std::ios::trunc);
+        manifest << nextIndex << '\n';
+        for (auto& segment : segments)
+            manifest << segment.bytes << ' ' << segment.path << '\n';
+    }
+
+    void applyRetentionLocked() {
+        uint64_t total = 0;
+        for (auto& segment : segments)
+            total += segment.bytes;
+
+        // Segments still waiting for the compressor are newest and are never dropped
+        while (!segments.empty() && !segments.front().pending
+            && ((policy.maxSegments > 0 && segments.size() > policy.maxSegments)
+                || (policy.maxTotalBytes > 0 && total > policy.maxTotalBytes))) {
+            total -= segments.front().bytes;
+            std::remove(segments.front().path.c_str());
+            segments.pop_front();
+        }
+    }
+
+public:
+    LogArchive(const std::string& path, const LogRotationPolicy& policy) : logPath(path), policy(policy) {
+        std::ifstream manifest(manifestPath());
+        if (!(manifest >> nextIndex))
+            nextIndex = 1;
+        Segment segment{ std::string(), 0, false };
+        while (manifest >> segment.bytes && std::getline(manifest >> std::ws, segment.path))
+            segments.push_back(segment);
+    }
+
+    const LogRotationPolicy& getPolicy() const { return policy; }
+
+    std::string nextSegmentPath() {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        return logPath + "." + std::to_string(nextIndex++);
+    }
+
+    void addSegment(const std::string& path, uint64_t bytes, bool pending) {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        segments.push_back(Segment{ path, bytes, pending });
+        applyRetentionLocked();
+        saveLocked();
+    }
+
+    /* Called by the compressor once "<segment>.lz" replaced the raw segment */
+    void replaceSegment(const std::string& from, const std::string& to, uint64_t bytes) {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        bool found = false;
+        for (auto& segment : segments) {
+            if (segment.path == from) {
+                segment.path = to;
+                segment.bytes = bytes;
+                segment.pending = false;
+                found = true;
+                break;
+            }
+        }
+        // Retention dropped the segment while it was being compressed
+        if (!found)
+            std::remove(to.c_str());
+        applyRetentionLocked();
+        saveLocked();
+    }
+};
+
+/* Compresses rotated segments on its own thread so writers never wait for it */
+class LogCompressor {
+private:
+    std::deque<std::pair<std::string, std::shared_ptr<LogArchive>>> jobs;
+    std::thread worker;
+    bool stopping = false;
+    std::mutex jobsMutex;
+    std::condition_variable jobsCondition;
+
+    LogCompressor() {}
+
+    static void compressSegment(const std::string& path, LogArchive& archive) {
+        std::string raw;
+        {
+            std::ifstream input(path, std::ios::binary);
+            if (!input)
+                return;
+            raw.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        }
+
+        std::string packed = compressLog(raw);
+        std::string packedPath = path + ".lz";
+        {
+            std::ofstream output(packedPath, std::ios::binary | std::ios::trunc);
+            output.write(packed.data(), static_cast<std::streamsize>(packed.size()));
+            if (!output)
+                return;
+        }
+        std::remove(path.c_str());
+        archive.replaceSegment(path, packedPath, packed.size());
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        for (;;) {
+            jobsCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            compressSegment(job.first, *job.second);
+            lock.lock();
+        }
+    }
+
+public:
+    LogCompressor(const LogCompressor&) = delete;
+    LogCompressor& operator=(const LogCompressor&) = delete;
+
+    ~LogCompressor() {
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            stopping = true;
+        }
+        jobsCondition.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    static LogCompressor& instance() {
+        static LogCompressor compressor;
+        return compressor;
+    }
+
+    void enqueue(const std::string& path, std::shared_ptr<LogArchive> archive) {
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            jobs.emplace_back(path, std::move(archive));
+            if (!worker.joinable())
+                worker = std::thread(&LogCompressor::run, this);
+        }
+        jobsCondition.notify_one();
+    }
+};
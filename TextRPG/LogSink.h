@@ -0,0 +1,204 @@
+#pragma once
+#include "LogRecord.h"
+#include "LogBinary.h"
+#include "LogRotation.h"
+#include "LogMetrics.h"
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Build with LOG_BINARY to make loggers write the compact binary format to
+ * log.bin by default; LogDecoder turns it back into text.
+ */
+#ifdef LOG_BINARY
+#define LOG_DEFAULT_FILE "log.bin"
+#define LOG_DEFAULT_FORMAT LogFormat::BINARY
+#else
+#define LOG_DEFAULT_FILE "log.txt"
+#define LOG_DEFAULT_FORMAT LogFormat::TEXT
+#endif
+
+/* Forwards to the file buffer and counts bytes so rotation needs no tellp() */
+class CountingStreamBuf : public std::streambuf {
+private:
+    std::streambuf* target;
+    uint64_t count = 0;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+            return traits_type::not_eof(ch);
+        ++count;
+        return target->sputc(traits_type::to_char_type(ch));
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        count += static_cast<uint64_t>(size);
+        return target->sputn(data, size);
+    }
+
+public:
+    explicit CountingStreamBuf(std::streambuf* target) : target(target) {}
+
+    uint64_t getCount() const { return count; }
+    void setCount(uint64_t value) { count = value; }
+};
+
+class LogSink {
+private:
+    std::string path;
+    LogFormat format;
+    std::unique_ptr<char[]> buffer;
+    std::ofstream file;
+    CountingStreamBuf counter;
+    std::ostream out;
+    LogBinaryEncoder encoder;
+
+    std::shared_ptr<LogArchive> archive;
+    time_t segmentStart = 0;
+
+    std::mutex sinkMutex;
+
+    void open() {
+        // libstdc++ takes the buffer only while the file is closed, MSVC only once it is open
+        bool buffered = buffer && file.rdbuf()->pubsetbuf(buffer.get(), bufferSize) != nullptr;
+        file.open(path, format == LogFormat::BINARY ? std::ios::app | std::ios::binary : std::ios::app);
+        if (buffer && !buffered && file.is_open() && file.rdbuf()->pubsetbuf(buffer.get(), bufferSize) == nullptr)
+            buffer.reset();  // Refused both times; the stream keeps its own buffer
+        counter.setCount(fileSize(path));
+        segmentStart = std::time(nullptr);
+        encoder = LogBinaryEncoder();
+    }
+
+    bool shouldRotate(const LogRecord& record) const {
+        const LogRotationPolicy& policy = archive->getPolicy();
+        if (counter.getCount() == 0)
+            return false;
+        return (policy.maxBytes > 0 && counter.getCount() >= policy.maxBytes)
+            || (policy.maxAge.count() > 0 && record.timestamp - segmentStart >= policy.maxAge.count());
+    }
+
+    /* Only renames the file here; compression and retention happen on LogCompressor's thread */
+    void rotateLocked() {
+        file.close();
+        uint64_t bytes = counter.getCount();
+        std::string segment = archive->nextSegmentPath();
+        std::remove(segment.c_str());
+        if (std::rename(path.c_str(), segment.c_str()) == 0) {
+            archive->addSegment(segment, bytes, archive->getPolicy().compress);
+            if (archive->getPolicy().compress)
+                LogCompressor::instance().enqueue(segment, archive);
+        }
+        open();
+    }
+
+public:
+    static const size_t bufferSize = 64 * 1024;
+
+    LogSink(const std::string& filename, LogFormat format = LogFormat::TEXT)
+        : path(filename), format(format), counter(file.rdbuf()), out(&counter) {
+        if (filename.empty())
+            return;
+        buffer.reset(new char[bufferSize]);
+        open();
+    }
+
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    const std::string& getPath() const { return path; }
+    LogFormat getFormat() const { return format; }
+    bool isOpen() const { return file.is_open(); }
+
+    /* Segments go to "<path>.N" (then "<path>.N.lz"); a policy with no limits turns rotation off */
+    void setRotation(const LogRotationPolicy& policy) {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        if (policy.enabled() && !path.empty())
+            archive = std::make_shared<LogArchive>(path, policy);
+        else
+            archive.reset();
+    }
+
+    /* Appends one line; the caller decides when the stream is flushed */
+    void write(const LogRecord& record, const std::string& loggerName, bool flushNow = false) {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        if (!file.is_open())
+            return;
+        if (archive && shouldRotate(record))
+            rotateLocked();
+        uint64_t before = counter.getCount();
+        if (format == LogFormat::BINARY)
+            encoder.write(out, record, loggerName);
+        else
+            writeRecordLine(out, record, loggerName);
+        LogMetrics::recordBytes(counter.getCount() - before);
+        if (flushNow)
+            file.flush();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        if (file.is_open())
+            file.flush();
+    }
+};
+
+/*
+ * Hands out one LogSink per file path. Loggers keep the sink alive through
+ * their shared_ptr; the registry only holds weak references, so the file is
+ * closed once the last logger writing to it is gone.
+ */
+class LogSinkRegistry {
+private:
+    std::unordered_map<std::string, std::weak_ptr<LogSink>> sinks;
+    std::string defaultPath = LOG_DEFAULT_FILE;
+    LogFormat defaultFormat = LOG_DEFAULT_FORMAT;
+    std::mutex registryMutex;
+
+    LogSinkRegistry() {
+        // Sinks may still rotate and count bytes while static loggers are destroyed
+        LogMetrics::instance();
+        LogCompressor::instance();
+    }
+
+    std::shared_ptr<LogSink> acquireLocked(const std::string& path, LogFormat format) {
+        std::weak_ptr<LogSink>& slot = sinks[path];
+        std::shared_ptr<LogSink> sink = slot.lock();
+        if (!sink) {
+            sink = std::make_shared<LogSink>(path, format);
+            slot = sink;
+        }
+        return sink;
+    }
+
+public:
+    LogSinkRegistry(const LogSinkRegistry&) = delete;
+    LogSinkRegistry& operator=(const LogSinkRegistry&) = delete;
+
+    static LogSinkRegistry& instance() {
+        static LogSinkRegistry registry;
+        return registry;
+    }
+
+    /* Only affects loggers constructed afterwards */
+    void setDefaultSink(const std::string& path, LogFormat format) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        defaultPath = path;
+        defaultFormat = format;
+    }
+
+    /* The format only matters when the sink is opened; an existing sink keeps its own */
+    std::shared_ptr<LogSink> acquire(const std::string& path, LogFormat format = LogFormat::TEXT) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return acquireLocked(path, format);
+    }
+
+    std::shared_ptr<LogSink> acquireDefault() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return acquireLocked(defaultPath, defaultFormat);
+    }
+};
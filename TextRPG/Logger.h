@@ -1,110 +1,200 @@
 #pragma once
+#include "LogRecord.h"
+#include "LogSink.h"
+#include "AsyncLogWriter.h"
+#include "LogHistory.h"
+#include "LogRateLimit.h"
+#include "LogMetrics.h"
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <vector>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <ctime>
 #include <typeinfo>
-
-enum class LogLevel {
-    DEBUG,
-    INFO,
-    WARNING,
-    ERROR,
-    CRITICAL
-};
-
-struct LogRecord {
-    LogLevel level;
-    std::string message;
-    time_t timestamp;
-};
-
-template <typename ClassType>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Lowest level that is compiled in at all. Release builds drop DEBUG unless
+ * the project defines LOG_MIN_LEVEL (0 = DEBUG ... 4 = CRITICAL).
+ */
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
+/*
+ * The message expression is only evaluated when the level is enabled and the
+ * site passes the logger's rate limit and sampling; for levels below the
+ * compiled-in minimum the whole statement folds away.
+ */
+#define LOG_AT(logger, level, message)                                  \
+    do {                                                                \
+        static LogSite logSite(__FILE__, __LINE__);                     \
+        if (std::decay<decltype(logger)>::type::isCompiledIn(level)     \
+            && (logger).isEnabled(level)                                \
+            && (logger).admit(logSite, level))                          \
+            (logger).log(level, message);                               \
+    } while (0)
+
+#define LOG_DEBUG(logger, message) LOG_AT(logger, LogLevel::DEBUG, message)
+#define LOG_INFO(logger, message) LOG_AT(logger, LogLevel::INFO, message)
+#define LOG_WARNING(logger, message) LOG_AT(logger, LogLevel::WARNING, message)
+#define LOG_ERROR(logger, message) LOG_AT(logger, LogLevel::ERROR, message)
+#define LOG_CRITICAL(logger, message) LOG_AT(logger, LogLevel::CRITICAL, message)
+
+/* Same as LOG_AT for templated messages: arguments are only evaluated if the site logs */
+#define LOG_ATF(logger, level, ...)                                     \
+    do {                                                                \
+        static LogSite logSite(__FILE__, __LINE__);                     \
+        if (std::decay<decltype(logger)>::type::isCompiledIn(level)     \
+            && (logger).isEnabled(level)                                \
+            && (logger).admit(logSite, level))                          \
+            (logger).logf(level, __VA_ARGS__);                          \
+    } while (0)
+
+#define LOG_DEBUGF(logger, ...) LOG_ATF(logger, LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFOF(logger, ...) LOG_ATF(logger, LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARNINGF(logger, ...) LOG_ATF(logger, LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERRORF(logger, ...) LOG_ATF(logger, LogLevel::ERROR, __VA_ARGS__)
+#define LOG_CRITICALF(logger, ...) LOG_ATF(logger, LogLevel::CRITICAL, __VA_ARGS__)
+
+template <typename ClassType, LogLevel CompiledMinLevel = static_cast<LogLevel>(LOG_MIN_LEVEL)>
 class Logger {
 private:
     std::string loggerName;
-    std::ofstream logFile;
+    std::shared_ptr<LogSink> sink;
+    AsyncLogWriter& writer;
+    LogHistory& history;
     bool outputToConsole;
     LogLevel minOutputLevel;
-    std::vector<LogRecord> records;
+    LogLimits limits;
     std::mutex logMutex;
 
+    static LogLimits& defaultLimits() {
+        static LogLimits value;
+        return value;
+    }
+
     std::string getClassName() const {
         return typeid(ClassType).name();
     }
 
-    std::string timestampToString(time_t timestamp) const {
-        char buffer[20];
-        struct tm timeInfo;
-        localtime_s(&timeInfo, &timestamp);
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeInfo);
-        return buffer;
+    void writeToFile(const LogRecord& record) {
+        if (writer.isRunning())
+            writer.submit(record, loggerName, sink);
+        else
+            sink->write(record, loggerName, true);
     }
 
-    std::string levelToString(LogLevel level) const {
-        switch (level) {
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO: return "INFO";
-            case LogLevel::WARNING: return "WARNING";
-            case LogLevel::ERROR: return "ERROR";
-            case LogLevel::CRITICAL: return "CRITICAL";
-            default: return "UNKNOWN";
-        }
+    static LogRecord& beginRecord(LogLevel level) {
+        LogRecord& record = threadLogRecord();
+        record.level = level;
+        record.message.clear();
+        record.timestamp = std::time(nullptr);
+        record.monotonicNs = 0;
+        record.format = nullptr;
+        return record;
     }
 
-    std::string colorizeLevel(LogLevel level) const {
-        switch (level) {
-            case LogLevel::DEBUG: return "\033[0m";
-            case LogLevel::INFO: return "\033[34m";
-            case LogLevel::WARNING: return "\033[33m";
-            case LogLevel::ERROR: return "\033[31m";
-            case LogLevel::CRITICAL: return "\033[35m";
-            default: return "\033[0m";
-        }
-    }
+    /* startNs is when log() was entered; the time spent up to here feeds LogMetrics */
+    void dispatch(LogRecord& record, int64_t startNs) {
+        if (subSecondTimestamps())
+            record.monotonicNs = startNs;
+        history.push(record, loggerName, startNs);
 
-    void writeToFile(const LogRecord& record) {
-        if (logFile.is_open()) {
-            logFile << timestampToString(record.timestamp) << " [" << levelToString(record.level)
-                << "] (" << loggerName << ") " << record.message << std::endl;
+        if (outputToConsole) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout << colorizeLevel(record.level);
+            writeRecordPrefix(std::cout, record, loggerName);
+            writeRecordMessage(std::cout, record);
+            std::cout << "\033[0m" << std::endl;
         }
+
+        writeToFile(record);
+        LogMetrics::recordLog(record.level, monotonicNanoseconds() - startNs);
     }
 
 public:
-    Logger(const std::string& filename = "log.txt")
-        : loggerName(getClassName()), outputToConsole(false), minOutputLevel(LogLevel::DEBUG) {
-        if (!filename.empty()) {
-            logFile.open(filename, std::ios::app);
+    explicit Logger(std::shared_ptr<LogSink> logSink)
+        : loggerName(getClassName()), sink(std::move(logSink)),
+        writer(AsyncLogWriter::instance()), history(LogHistory::instance()), outputToConsole(false), minOutputLevel(LogLevel::DEBUG), limits(defaultLimits()) {
+        if (!sink->getPath().empty()) {
             debug("Logger created");
         }
     }
 
+    Logger() : Logger(LogSinkRegistry::instance().acquireDefault()) {}
+
+    Logger(const std::string& filename, LogFormat format = LogFormat::TEXT)
+        : Logger(LogSinkRegistry::instance().acquire(filename, format)) {}
+
     ~Logger() {
         debug("Logger destroyed");
-        if (logFile.is_open()) {
-            logFile.close();
-        }
     }
 
     void setLoggerName(const std::string& name) { loggerName = name; }
     void setOutputToConsole(bool value) { outputToConsole = value; }
     void setMinOutputLevel(LogLevel level) { minOutputLevel = level; }
 
-    void log(LogLevel level, const std::string& message) {
-        if (level < minOutputLevel) return;
+    /* Limits only apply to LOG_* macro sites; direct calls are never dropped */
+    void setRateLimit(uint32_t perSecond) { limits.perSecond = perSecond; }
+    void setDebugSampling(uint32_t every) {
+        if (every == 0)
+            throw std::invalid_argument("Debug sampling must be greater than 0");
+        limits.debugSampling = every;
+    }
+    const LogLimits& getLimits() const { return limits; }
+
+    /* Defaults for loggers of this class created afterwards */
+    static void setDefaultRateLimit(uint32_t perSecond) { defaultLimits().perSecond = perSecond; }
+    static void setDefaultDebugSampling(uint32_t every) {
+        if (every == 0)
+            throw std::invalid_argument("Debug sampling must be greater than 0");
+        defaultLimits().debugSampling = every;
+    }
 
-        std::lock_guard<std::mutex> lock(logMutex);
-        LogRecord record { level, message, std::time(nullptr) };
-        records.push_back(record);
+    static constexpr bool isCompiledIn(LogLevel level) { return level >= CompiledMinLevel; }
+    bool isEnabled(LogLevel level) const { return isCompiledIn(level) && level >= minOutputLevel; }
+
+    bool admit(LogSite& site, LogLevel level) {
+        uint64_t suppressed = 0;
+        bool admitted = admitLogSite(site, level, limits, suppressed);
+        if (suppressed > 0)
+            logf(level, "Suppressed {} messages at {}:{}", suppressed, site.fileName(), site.line);
+        if (!admitted)
+            LogMetrics::recordSuppressed();
+        return admitted;
+    }
 
-        if (outputToConsole) {
-            std::cout << colorizeLevel(level) << timestampToString(record.timestamp) << " [" << levelToString(level)
-                << "] (" << loggerName << ") " << message << "\033[0m" << std::endl;
-        }
+    void log(LogLevel level, const std::string& message) {
+        if (!isEnabled(level)) return;
 
-        writeToFile(record);
+        int64_t startNs = monotonicNanoseconds();
+        LogRecord& record = beginRecord(level);
+        record.message.assign(message);
+        dispatch(record, startNs);
+    }
+
+    /*
+     * Structured call: each "{}" in format is replaced by the next argument.
+     * format must outlive the process (use a string literal); arguments are
+     * stored raw and only turned into text by text sinks. They are encoded
+     * into a per-thread buffer, so steady-state calls do not allocate.
+     */
+    template <typename... Args>
+    void logf(LogLevel level, const char* format, const Args&... args) {
+        if (!isEnabled(level)) return;
+
+        int64_t startNs = monotonicNanoseconds();
+        LogRecord& record = beginRecord(level);
+        encodeLogArgs(record.message, args...);
+        record.format = format;
+        dispatch(record, startNs);
     }
 
     void debug(const std::string& message) { log(LogLevel::DEBUG, message); }
@@ -112,4 +202,33 @@ public:
     void warning(const std::string& message) { log(LogLevel::WARNING, message); }
     void error(const std::string& message) { log(LogLevel::ERROR, message); }
     void critical(const std::string& message) { log(LogLevel::CRITICAL, message); }
+
+    template <typename... Args>
+    void debugf(const char* format, const Args&... args) { logf(LogLevel::DEBUG, format, args...); }
+    template <typename... Args>
+    void infof(const char* format, const Args&... args) { logf(LogLevel::INFO, format, args...); }
+    template <typename... Args>
+    void warningf(const char* format, const Args&... args) { logf(LogLevel::WARNING, format, args...); }
+    template <typename... Args>
+    void errorf(const char* format, const Args&... args) { logf(LogLevel::ERROR, format, args...); }
+    template <typename... Args>
+    void criticalf(const char* format, const Args&... args) { logf(LogLevel::CRITICAL, format, args...); }
+
+    /* Lazy overloads: build() runs only if the level is enabled */
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void log(LogLevel level, MessageBuilder&& build) {
+        if (!isEnabled(level)) return;
+        log(level, std::string(build()));
+    }
+
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void debug(MessageBuilder&& build) { log(LogLevel::DEBUG, std::forward<MessageBuilder>(build)); }
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void info(MessageBuilder&& build) { log(LogLevel::INFO, std::forward<MessageBuilder>(build)); }
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void warning(MessageBuilder&& build) { log(LogLevel::WARNING, std::forward<MessageBuilder>(build)); }
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void error(MessageBuilder&& build) { log(LogLevel::ERROR, std::forward<MessageBuilder>(build)); }
+    template <typename MessageBuilder, typename = decltype(std::declval<MessageBuilder&>()())>
+    void critical(MessageBuilder&& build) { log(LogLevel::CRITICAL, std::forward<MessageBuilder>(build)); }
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/* Mixes a 64-bit value into a well spread one; consecutive inputs give unrelated outputs */
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/*
+ * xoshiro128** (Blackman and Vigna): 16 bytes of state and a few shifts
+ * and rotates per number. Unlike rand() it has no shared state and no lock,
+ * and the seed it was made from is kept, so a fight can be played again
+ * from its recorded seed. One generator per fight or per thread; a
+ * generator must not be used from two threads at once.
+ */
+class Random {
+private:
+    uint32_t state[4];
+    uint64_t seed;
+
+    static uint32_t rotate(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+public:
+    typedef uint32_t result_type;
+
+    explicit Random(uint64_t seed = 0) { reseed(seed); }
+
+    /* Generator number stream of a family sharing seed, e.g. one per simulation thread */
+    Random(uint64_t seed, uint64_t stream) {
+        uint64_t mixed = seed;
+        splitMix64(mixed);
+        reseed(mixed ^ (stream * 0xD1B54A32D192ED03ull));
+    }
+
+    void reseed(uint64_t value) {
+        seed = value;
+        uint64_t mix = value;
+        uint64_t low = splitMix64(mix);
+        uint64_t high = splitMix64(mix);
+        state[0] = static_cast<uint32_t>(low);
+        state[1] = static_cast<uint32_t>(low >> 32);
+        state[2] = static_cast<uint32_t>(high);
+        state[3] = static_cast<uint32_t>(high >> 32);
+        // An all-zero state would only ever give zeros
+        if ((state[0] | state[1] | state[2] | state[3]) == 0)
+            state[0] = 1;
+    }
+
+    uint64_t getSeed() const { return seed; }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    result_type operator()() {
+        uint32_t result = rotate(state[1] * 5, 7) * 9;
+        uint32_t shifted = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate(state[3], 11);
+        return result;
+    }
+
+    /* Uniform in [0, bound); a multiply instead of %, so small bounds are not skewed towards low values */
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * bound) >> 32); }
+
+    /* true with the given chance in percent */
+    bool chance(uint32_t percent) { return below(100) < percent; }
+
+    /* A seed for a new game: the clock mixed with the system's entropy source */
+    static uint64_t makeSeed() {
+        uint64_t clock = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        std::random_device device;
+        uint64_t entropy = (static_cast<uint64_t>(device()) << 32) | device();
+        return splitMix64(clock) ^ entropy;
+    }
+};
@@ -10,5 +10,5 @@ void Scenario::execute(Game& game) {
 	for (auto& entity : entities)
 		game.addEntity(entity);
 
-	dialogueSystem->execute(nullptr);
+	dialogueSystem->execute(&game);
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/*
+ * Animates text on its own thread so the game thread never sleeps while a
+ * dialogue is typed out. Every frame the thread writes all characters that
+ * have become due as one chunk and flushes once, instead of one write and a
+ * sleep per character. Output is shown in the order it was queued.
+ */
+class TypewriterRenderer {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        std::string text;
+        std::chrono::microseconds charDelay;
+        // Wait before the first character, counted from the end of the previous job
+        std::chrono::microseconds pause;
+    };
+
+    std::ostream& out;
+    std::deque<Job> jobs;
+    size_t written = 0;
+    Clock::time_point jobStart;
+    bool jobStarted = false;
+    // A chunk has been taken off the queue but is not on screen yet
+    bool writing = false;
+    std::chrono::milliseconds frameInterval{ 30 };
+
+    std::thread worker;
+    bool stopping = false;
+    bool skipping = false;
+    std::mutex renderMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable idleCondition;
+
+    TypewriterRenderer() : out(std::cout) {}
+
+    /* Moves everything due at now into chunk; returns when the next character is due */
+    Clock::time_point collectLocked(Clock::time_point now, std::string& chunk) {
+        while (!jobs.empty()) {
+            Job& job = jobs.front();
+            if (!jobStarted) {
+                jobStart = std::max(jobStart, now) + job.pause;
+                jobStarted = true;
+            }
+
+            size_t due = job.text.size();
+            if (!skipping && job.charDelay.count() > 0) {
+                if (now < jobStart)
+                    return jobStart;
+                due = std::min(due, static_cast<size_t>((now - jobStart) / job.charDelay) + 1);
+            }
+            else if (!skipping && now < jobStart) {
+                return jobStart;
+            }
+
+            chunk.append(job.text, written, due - written);
+            written = due;
+            if (written < job.text.size())
+                return jobStart + job.charDelay * static_cast<long long>(written);
+
+            // The next job starts where this one ideally ended, so pacing does not drift
+            if (skipping)
+                jobStart = now;
+            else
+                jobStart += job.charDelay * static_cast<long long>(job.text.size());
+            jobStarted = false;
+            written = 0;
+            jobs.pop_front();
+        }
+        return Clock::time_point::max();
+    }
+
+    void run() {
+        std::string chunk;
+        std::unique_lock<std::mutex> lock(renderMutex);
+        for (;;) {
+            chunk.clear();
+            Clock::time_point nextDue = collectLocked(Clock::now(), chunk);
+
+            if (!chunk.empty()) {
+                writing = true;
+                lock.unlock();
+                out << chunk << std::flush;
+                lock.lock();
+                writing = false;
+            }
+            if (jobs.empty()) {
+                // Only once the last chunk is out: a skip during that write must not carry over to the next text
+                skipping = false;
+                idleCondition.notify_all();
+                if (stopping)
+                    return;
+                wakeCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+                continue;
+            }
+
+            Clock::time_point wakeAt = std::max(nextDue, Clock::now() + frameInterval);
+            wakeCondition.wait_until(lock, wakeAt, [this] { return stopping || skipping; });
+            if (stopping)
+                skipping = true;
+        }
+    }
+
+    void enqueue(const std::string& text, std::chrono::microseconds charDelay, std::chrono::microseconds pause) {
+        {
+            std::lock_guard<std::mutex> lock(renderMutex);
+            jobs.push_back(Job{ text, charDelay, pause });
+            if (!worker.joinable()) {
+                jobStart = Clock::now();
+                worker = std::thread(&TypewriterRenderer::run, this);
+            }
+        }
+        wakeCondition.notify_one();
+    }
+
+public:
+    TypewriterRenderer(const TypewriterRenderer&) = delete;
+    TypewriterRenderer& operator=(const TypewriterRenderer&) = delete;
+
+    /* Whatever is still queued at exit is shown at once */
+    ~TypewriterRenderer() {
+        {
+            std::lock_guard<std::mutex> lock(renderMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    static TypewriterRenderer& instance() {
+        static TypewriterRenderer renderer;
+        return renderer;
+    }
+
+    void setFrameInterval(std::chrono::milliseconds value) {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        frameInterval = value;
+    }
+
+    /* Types text one character per charDelay; returns immediately */
+    void type(const std::string& text, std::chrono::microseconds charDelay) {
+        enqueue(text, charDelay, std::chrono::microseconds(0));
+    }
+
+    /* Shows text in one piece once pause has passed */
+    void print(const std::string& text, std::chrono::microseconds pause = std::chrono::microseconds(0)) {
+        enqueue(text, std::chrono::microseconds(0), pause);
+    }
+
+    bool isIdle() {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        return jobs.empty() && !writing;
+    }
+
+    /* Shows everything queued right away and waits until it is on screen */
+    void skip() {
+        std::unique_lock<std::mutex> lock(renderMutex);
+        if (jobs.empty() && !writing)
+            return;
+        skipping = true;
+        wakeCondition.notify_one();
+        idleCondition.wait(lock, [this] { return jobs.empty() && !writing; });
+    }
+
+    /* Waits until the queued text has finished animating */
+    void finish() {
+        std::unique_lock<std::mutex> lock(renderMutex);
+        idleCondition.wait(lock, [this] { return jobs.empty() && !writing; });
+    }
+};
@@ -1,6 +1,10 @@
 ﻿#include "Scenario.h"
 #include "Dialogue.h"
+#include "DialogueCompiler.h"
 #include "Logger.h"
+#include "AsyncLogWriter.h"
+#include "LogHistory.h"
+#include "LogSink.h"
 #include "Items.h"
 #include "Entity.h"
 #include "Game.h"
@@ -16,6 +20,7 @@ Game game;
 
 void handleSignal(int signal) {
     logger->debug("Interrupt signal (" + std::to_string(signal) + ") received.");
+    AsyncLogWriter::instance().flush();
     game.save("data.bin");
     exit(signal);
 }
@@ -25,10 +30,27 @@ bool saveFileExists(const std::string& filename) {
     return file.good();
 }
 
-int main() {
+/* TextRPG [seed]: a seed plays the same fights again for the same answers */
+int main(int argc, char* argv[]) {
     std::setlocale(LC_ALL, "en_US.UTF-8");
+    AsyncLogWriter::instance().start();
+
+    LogRotationPolicy rotation;
+    rotation.maxBytes = 8 * 1024 * 1024;
+    rotation.maxAge = std::chrono::hours(24);
+    rotation.maxSegments = 8;
+    rotation.maxTotalBytes = 16 * 1024 * 1024;
+    LogSinkRegistry::instance().acquireDefault()->setRotation(rotation);
+
+    // Every hit and every render logs; big fights must not flood the sinks
+    Logger<Entity>::setDefaultRateLimit(200);
+    Logger<DialogueSystem>::setDefaultRateLimit(200);
     signal(SIGINT, handleSignal);
 
+    if (argc > 1)
+        game.setSeed(std::strtoull(argv[1], nullptr, 10));
+    logger->infof("Game seed {}", game.getSeed());
+
     try {
         Scenario scenario("darkForestScenario");
 
@@ -41,22 +63,24 @@ int main() {
 
         std::shared_ptr<DialogueSystem> ds = scenario.getDialogueSystem();
 
-        ds->createNewDialogue("You have entered the haunted castle. The air is thick with the smell of decay.");
-        ds->createNewDialogue("A ghostly figure appears before you. 'Who dares to enter my domain?' it asks.");
-        ds->createNewDialogue("When you defeat the ghost, you can rest for a while and recover your strength.");
-
+        // castle.dlgc is compiled again from castle.dlg when missing or older than the script
+        if (!isDialogueImageCurrent("castle.dlg", "castle.dlgc"))
+            compileDialogueFile("castle.dlg", "castle.dlgc");
+        ds->loadImage("castle.dlgc");
 
-        ds->addChoiceToDialogue("Fight the ghost", [&](void*) {
+        ds->bindAction("fight", [](Game* game) {
             std::cout << "\033[34mYou draw your sword, ready to fight the ghost.\033[0m\n";
-            game.addEntity(std::make_shared<Monster>(0, "Ghost", 50, 10, 5, 100));
-            game.startFight();
-        }, ds->searchDialogue(2), 1);
-        ds->addChoiceToDialogue("Run away", [&](void*) {
+            game->addEntity(std::make_shared<Monster>(0, "Ghost", 50, 10, 5, 100));
+            game->startFight();
+        });
+        ds->bindAction("flee", [](Game* game) {
             std::cout << "\033[31mYou decide to run away, but the ghost blocks your path.\033[0m\n";
-            game.addEntity(std::make_shared<Monster>(0, "Ghost", 50, 10, 5, 100));
-            game.startFight();
-        }, ds->searchDialogue(2), 1);
+            game->addEntity(std::make_shared<Monster>(0, "Ghost", 50, 10, 5, 100));
+            game->startFight();
+        });
 
+        // Saves only append the choices made since the previous one
+        ds->setChoiceJournal("data.choices");
 
         game.setScenario(std::make_shared<Scenario>(scenario));
 
@@ -87,6 +111,8 @@ int main() {
     }
     catch (const std::exception& e) {
         logger->error(e.what());
+        std::cerr << "[-] Last log records:" << std::endl;
+        LogHistory::instance().dump(std::cerr, 50);
         return -1;
     }
     return 0;
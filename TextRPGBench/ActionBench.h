@@ -0,0 +1,106 @@
+#pragma once
+#include "../TextRPG/ChoiceAction.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Heap allocations made so far, counted by the operator new in main.cpp
+extern std::atomic<size_t> benchAllocations;
+
+struct ActionBenchContext {
+    uint64_t hits = 0;
+};
+
+/*
+ * Stores count choice actions, each a lambda capturing three references
+ * like the game's fight menu does, then calls every one of them rounds
+ * times. "nested function" is the old Choice<T> path: a typed
+ * std::function wrapped in a std::function<void(void*)> lambda.
+ */
+inline void runActionBench(size_t count, size_t rounds) {
+    typedef std::chrono::steady_clock Clock;
+    auto nsPer = [](Clock::duration elapsed, size_t total) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total;
+    };
+
+    std::cout << std::left << std::setw(18) << "storage" << std::right
+        << std::setw(14) << "store ns" << std::setw(14) << "allocs/act" << std::setw(14) << "call ns" << std::endl;
+
+    uint64_t damage = 3;
+    uint64_t healing = 2;
+    uint64_t turns = 0;
+    auto makeAction = [&](size_t i) {
+        uint64_t* target = i % 2 ? &damage : &healing;
+        return [target, &turns, i](ActionBenchContext* context) {
+            context->hits += *target + (i & 1);
+            ++turns;
+        };
+    };
+
+    auto report = [&](const std::string& name, Clock::duration stored, size_t allocations, Clock::duration called) {
+        std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << nsPer(stored, count)
+            << std::setw(14) << static_cast<double>(allocations) / count
+            << std::setw(14) << nsPer(called, count * rounds) << std::endl;
+    };
+
+    ActionBenchContext context;
+    {
+        std::vector<std::function<void(void*)>> actions;
+        actions.reserve(count);
+        size_t allocations = benchAllocations.load();
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            std::function<void(ActionBenchContext*)> typed = makeAction(i);
+            actions.push_back([typed](void* param) { typed(static_cast<ActionBenchContext*>(param)); });
+        }
+        Clock::time_point stored = Clock::now();
+        allocations = benchAllocations.load() - allocations;
+        for (size_t round = 0; round < rounds; ++round) {
+            for (auto& action : actions)
+                action(&context);
+        }
+        report("nested function", stored - start, allocations, Clock::now() - stored);
+    }
+    {
+        std::vector<std::function<void(void*)>> actions;
+        actions.reserve(count);
+        size_t allocations = benchAllocations.load();
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            auto action = makeAction(i);
+            actions.push_back([action](void* param) { action(static_cast<ActionBenchContext*>(param)); });
+        }
+        Clock::time_point stored = Clock::now();
+        allocations = benchAllocations.load() - allocations;
+        for (size_t round = 0; round < rounds; ++round) {
+            for (auto& action : actions)
+                action(&context);
+        }
+        report("function", stored - start, allocations, Clock::now() - stored);
+    }
+    {
+        std::vector<ChoiceAction<ActionBenchContext>> actions;
+        actions.reserve(count);
+        size_t allocations = benchAllocations.load();
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i)
+            actions.emplace_back(makeAction(i));
+        Clock::time_point stored = Clock::now();
+        allocations = benchAllocations.load() - allocations;
+        for (size_t round = 0; round < rounds; ++round) {
+            for (auto& action : actions)
+                action(&context);
+        }
+        report("ChoiceAction", stored - start, allocations, Clock::now() - stored);
+    }
+
+    // Keeps the calls from being optimized away
+    if (context.hits + turns == 0)
+        std::cout << std::endl;
+}
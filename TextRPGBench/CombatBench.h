@@ -0,0 +1,89 @@
+#pragma once
+#include "../TextRPG/CombatSimulation.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+inline CombatSetup makeBenchSetup(const std::vector<Combatant>& monsters, size_t fightsPerRun) {
+    CombatSetup setup;
+    // The adventurer of main.cpp
+    setup.player.health = 120;
+    setup.player.damage = 12;
+    setup.player.defense = 7;
+    setup.potions = 3;
+    setup.monsters = monsters;
+    setup.fightsPerRun = fightsPerRun;
+    return setup;
+}
+
+inline Combatant benchMonster(int health, int damage, int defense, int expByKill) {
+    Combatant monster;
+    monster.health = health;
+    monster.damage = damage;
+    monster.defense = defense;
+    monster.expByKill = expByKill;
+    return monster;
+}
+
+template <typename PlayerPolicy, typename MonsterPolicy>
+CombatStatistics reportCombat(const std::string& name, const CombatSetup& setup, uint64_t runs, unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    CombatStatistics stats = simulateCombat<PlayerPolicy, MonsterPolicy>(setup, runs, 42, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const CombatCurvePoint& last = stats.curve.back();
+    std::cout << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(8) << 100.0 * stats.winRate()
+        << std::setw(8) << (stats.fights ? 100.0 * stats.stalls / stats.fights : 0.0)
+        << std::setw(8) << stats.averageTurnsToWin()
+        << std::setw(6) << stats.turnsToWinPercentile(0.5)
+        << std::setw(6) << stats.turnsToWinPercentile(0.9)
+        << std::setw(8) << (last.survived ? static_cast<double>(last.level) / last.survived : 0.0)
+        << std::setw(14) << static_cast<uint64_t>(stats.fights / seconds) << std::endl;
+    return stats;
+}
+
+/*
+ * Balance numbers for the monsters of Entity.h against the adventurer of
+ * main.cpp: win rate, stalled fights (nobody can hurt the other), turns to
+ * win (mean, median, 90th percentile), level after the last fight and
+ * fights simulated per second. Ends with the experience curve of a run
+ * through ten goblin fights.
+ */
+inline void runCombatBench(uint64_t runs, unsigned threads) {
+    Combatant goblin = benchMonster(50, 15, 5, 25);
+    Combatant skeleton = benchMonster(100, 20, 10, 50);
+    Combatant dragon = benchMonster(200, 30, 15, 100);
+
+    std::cout << runs << " runs on " << (threads ? threads : std::max(1u, std::thread::hardware_concurrency())) << " threads" << std::endl;
+    std::cout << std::left << std::setw(30) << "fight" << std::right
+        << std::setw(8) << "win %" << std::setw(8) << "stall %" << std::setw(8) << "turns"
+        << std::setw(6) << "p50" << std::setw(6) << "p90" << std::setw(8) << "level" << std::setw(14) << "fights/s" << std::endl;
+
+    CombatSetup goblins = makeBenchSetup({ goblin, goblin }, 1);
+    reportCombat<AttackFirstPolicy, RetaliatePolicy>("2 goblins, first", goblins, runs, threads);
+    reportCombat<AttackWeakestPolicy, RetaliatePolicy>("2 goblins, weakest", goblins, runs, threads);
+    reportCombat<AttackWeakestPolicy, PackPolicy>("2 goblins, weakest, pack", goblins, runs, threads);
+    reportCombat<HealWhenLowPolicy, PackPolicy>("2 goblins, heal, pack", goblins, runs, threads);
+    CombatSetup healing = goblins;
+    healing.potionHealth = 25;
+    reportCombat<HealWhenLowPolicy, PackPolicy>("2 goblins, heal 25, pack", healing, runs, threads);
+    reportCombat<AttackFirstPolicy, RetaliatePolicy>("skeleton", makeBenchSetup({ skeleton }, 1), runs, threads);
+    reportCombat<AttackFirstPolicy, RetaliatePolicy>("dragon", makeBenchSetup({ dragon }, 1), runs, threads);
+
+    CombatStatistics campaign = reportCombat<AttackFirstPolicy, RetaliatePolicy>("10 goblins in a row", makeBenchSetup({ goblin }, 10), runs, threads);
+    std::cout << std::endl << std::setw(6) << "fight" << std::setw(12) << "alive %" << std::setw(10) << "level"
+        << std::setw(12) << "exp earned" << std::setw(10) << "health" << std::endl;
+    for (size_t i = 0; i < campaign.curve.size(); ++i) {
+        const CombatCurvePoint& point = campaign.curve[i];
+        double survived = point.survived ? static_cast<double>(point.survived) : 1.0;
+        std::cout << std::setw(6) << i + 1 << std::fixed << std::setprecision(1)
+            << std::setw(12) << 100.0 * point.survived / runs
+            << std::setw(10) << point.level / survived
+            << std::setw(12) << point.earned / survived
+            << std::setw(10) << point.health / survived << std::endl;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../TextRPG/Dialogue.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Builds a dialogue chain of the given size, then adds one choice per
+ * dialogue at a random id and looks every id up again. All three phases
+ * should cost the same per dialogue at any size; bytes/node is what the
+ * graph itself holds, choices and text included. Last, the graph is saved
+ * as a compiled image and mapped back, which should not grow with size.
+ */
+inline void runDialogueBench(const std::vector<size_t>& sizes) {
+    typedef std::chrono::steady_clock Clock;
+    auto nsPer = [](Clock::duration elapsed, size_t count) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / count;
+    };
+
+    std::cout << std::left << std::setw(10) << "dialogues" << std::right
+        << std::setw(14) << "create ns" << std::setw(14) << "choice ns" << std::setw(14) << "search ns"
+        << std::setw(12) << "total ms" << std::setw(14) << "bytes/node" << std::setw(12) << "map us" << std::endl;
+
+    for (size_t size : sizes) {
+        std::mt19937 random(static_cast<uint32_t>(size));
+        std::uniform_int_distribution<size_t> anyId(0, size - 1);
+        DialogueSystem system;
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < size; ++i)
+            system.createNewDialogue("Dialogue text");
+        Clock::time_point created = Clock::now();
+
+        for (size_t i = 0; i < size; ++i)
+            system.addChoiceToDialogue("Choice", system.searchDialogue(anyId(random)), static_cast<int>(anyId(random)));
+        Clock::time_point linked = Clock::now();
+
+        size_t found = 0;
+        for (size_t i = 0; i < size; ++i)
+            found += system.searchDialogue(anyId(random)) != noDialogue ? 1 : 0;
+        Clock::time_point searched = Clock::now();
+
+        if (found != size)
+            std::cerr << "[-] " << size - found << " lookups failed" << std::endl;
+
+        {
+            std::ofstream image("bench.dlgc", std::ios::binary | std::ios::trunc);
+            system.getGraph().writeImage(image, system.getStartDialogue(), system.getEndDialogue());
+        }
+        DialogueSystem mapped;
+        Clock::time_point mapStart = Clock::now();
+        mapped.loadImage("bench.dlgc");
+        Clock::time_point mapEnd = Clock::now();
+        if (mapped.dialogueCount() != size)
+            std::cerr << "[-] Mapped " << mapped.dialogueCount() << " dialogues" << std::endl;
+
+        std::cout << std::left << std::setw(10) << size << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << nsPer(created - start, size)
+            << std::setw(14) << nsPer(linked - created, size)
+            << std::setw(14) << nsPer(searched - linked, size)
+            << std::setw(12) << std::chrono::duration_cast<std::chrono::milliseconds>(searched - start).count()
+            << std::setw(14) << static_cast<double>(system.getMemoryUsage()) / size
+            << std::setw(12) << std::chrono::duration_cast<std::chrono::microseconds>(mapEnd - mapStart).count()
+            << std::endl;
+    }
+    std::remove("bench.dlgc");
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "../TextRPG/EntityStore.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * A battle of count goblins, skeletons and dragons kept as the game keeps
+ * them (Game::entities) and in an EntityStore: a scan for living entities,
+ * then rounds of area damage that every entity takes. The combat log of
+ * Entity::takeDamage, and the events of the batch, are rendered into a
+ * discarded buffer once per round. The store is hit one entity at a time,
+ * as one batch, and as one batch whose events are logged afterwards.
+ */
+inline void runEntityBench(size_t count, size_t rounds) {
+    typedef std::chrono::steady_clock Clock;
+    auto nsPer = [](Clock::duration elapsed, size_t total) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total;
+    };
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    EntityStore store;
+    std::vector<DamageEvent> events;
+    entities.reserve(count);
+    store.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        int id = static_cast<int>(i);
+        if (i % 3 == 0)
+            entities.push_back(std::make_shared<Goblin>(id));
+        else if (i % 3 == 1)
+            entities.push_back(std::make_shared<Skeleton>(id));
+        else
+            entities.push_back(std::make_shared<Dragon>(id));
+        store.add(*entities.back());
+    }
+
+    std::cout << "Batch damage uses " << (BATCH_DAMAGE_SSE2 ? "SSE2" : "scalar code") << std::endl;
+    std::cout << std::left << std::setw(20) << "storage" << std::right
+        << std::setw(14) << "scan ns" << std::setw(14) << "damage ns" << std::setw(12) << "alive" << std::endl;
+    std::ostringstream discarded;
+    CombatLog log(std::make_shared<ConsoleCombatRenderer>(discarded));
+    auto report = [&](const std::string& name, Clock::duration scan, Clock::duration damage, size_t alive) {
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << nsPer(scan, count * rounds)
+            << std::setw(14) << nsPer(damage, count * rounds)
+            << std::setw(12) << alive << std::endl;
+    };
+
+    {
+        size_t alive = 0;
+        Clock::duration scan{};
+        Clock::duration damage{};
+        for (size_t round = 0; round < rounds; ++round) {
+            Clock::time_point start = Clock::now();
+            alive = 0;
+            for (auto& entity : entities)
+                alive += entity->isAlive() ? 1 : 0;
+            Clock::time_point scanned = Clock::now();
+            for (auto& entity : entities)
+                entity->takeDamage(20, log);
+            log.flush();
+            damage += Clock::now() - scanned;
+            scan += scanned - start;
+            discarded.str(std::string());
+        }
+        report("shared_ptr<Entity>", scan, damage, alive);
+    }
+    auto runStore = [&](const std::string& name, int mode) {
+        EntityStore battle = store;
+        size_t alive = 0;
+        Clock::duration scan{};
+        Clock::duration damage{};
+        for (size_t round = 0; round < rounds; ++round) {
+            Clock::time_point start = Clock::now();
+            alive = battle.countAlive();
+            Clock::time_point scanned = Clock::now();
+            if (mode == 0) {
+                for (size_t i = 0; i < battle.size(); ++i)
+                    battle.applyDamage(i, 20);
+            }
+            else if (mode == 1) {
+                battle.applyDamageToAll(20);
+            }
+            else {
+                events.clear();
+                battle.applyDamageToAll(20, &events);
+                logDamageEvents(log, battle, events);
+                log.flush();
+                discarded.str(std::string());
+            }
+            damage += Clock::now() - scanned;
+            scan += scanned - start;
+        }
+        report(name, scan, damage, alive);
+    };
+    runStore("store, one by one", 0);
+    runStore("store, batch", 1);
+    runStore("store, + events", 2);
+
+    size_t entityBytes = count * (sizeof(Entity) + 2 * sizeof(void*));
+    std::cout << "Memory: ~" << entityBytes / 1024 << " KB of Entity objects, " << store.memoryUsage() / 1024 << " KB in the store" << std::endl;
+}
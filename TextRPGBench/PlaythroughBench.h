@@ -0,0 +1,54 @@
+#pragma once
+#include "../TextRPG/Dialogue.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+ * Headless playthroughs of a branching story: every fourth dialogue offers
+ * "continue", "skip one" and "jump to the end". Each run replays one of a
+ * pool of random input scripts, some with invalid answers mixed in.
+ */
+inline void runPlaythroughBench(size_t dialogues, size_t runs) {
+    DialogueSystem system;
+    for (size_t i = 0; i < dialogues; ++i)
+        system.createNewDialogue("Dialogue " + std::to_string(i));
+
+    DialogueId last = static_cast<DialogueId>(dialogues - 1);
+    for (size_t i = 0; i + 1 < dialogues; i += 4) {
+        int id = static_cast<int>(i);
+        system.addChoiceToDialogue("Continue", static_cast<DialogueId>(i + 1), id);
+        system.addChoiceToDialogue("Skip", static_cast<DialogueId>(std::min(i + 2, dialogues - 1)), id);
+        system.addChoiceToDialogue("Jump to the end", last, id);
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> answer(0, 40);
+    std::vector<std::vector<int>> scripts(64);
+    for (auto& script : scripts) {
+        for (size_t i = 0; i < dialogues; ++i) {
+            int value = answer(random);
+            // Mostly "continue", now and then a skip, a jump or a typo
+            script.push_back(value == 0 ? 0 : value < 36 ? 1 : value < 40 ? 2 : 3);
+        }
+    }
+
+    DialogueRun run;
+    size_t steps = 0;
+    size_t completed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; ++i) {
+        DialogueScript script(scripts[i % scripts.size()]);
+        system.runHeadless(script, run);
+        steps += run.path.size();
+        completed += run.completed ? 1 : 0;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << runs << " playthroughs of " << dialogues << " dialogues in " << seconds * 1000 << " ms: "
+        << static_cast<uint64_t>(runs / seconds) << " runs/s, "
+        << static_cast<double>(steps) / runs << " dialogues per run, "
+        << completed << " completed" << std::endl;
+}
@@ -0,0 +1,137 @@
+#include "ActionBench.h"
+#include "CombatBench.h"
+#include "DialogueBench.h"
+#include "EntityBench.h"
+#include "PlaythroughBench.h"
+#include "../TextRPG/AsyncLogWriter.h"
+#include "../TextRPG/LogSink.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+std::atomic<size_t> benchAllocations{ 0 };
+
+/*
+ * Every replaceable form goes through malloc and free, so nothing allocated
+ * by one form is released by the library's version of another. C++14 has no
+ * aligned forms to replace. GCC cannot see that operator new uses malloc and
+ * takes the free calls below for mismatched deallocations.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+inline void* benchAllocate(size_t size) noexcept {
+    benchAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    if (void* memory = benchAllocate(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* memory = benchAllocate(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return benchAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return benchAllocate(size); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/*
+ * Benchmarks for TextRPG internals. Loggers write nowhere unless --log is
+ * given, so the numbers show the game code rather than the disk.
+ *
+ *   TextRPGBench dialogue [size ...] [--log]
+ *   TextRPGBench playthrough [dialogues] [runs] [--log]
+ *   TextRPGBench actions [count] [rounds]
+ *   TextRPGBench combat [runs] [threads]
+ *   TextRPGBench entities [count] [rounds]
+ */
+int main(int argc, char* argv[]) {
+    std::string bench;
+    std::vector<size_t> sizes;
+    bool logToFile = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--log") {
+            logToFile = true;
+        }
+        else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: TextRPGBench dialogue [size ...] [--log]" << std::endl;
+            std::cout << "       TextRPGBench playthrough [dialogues] [runs] [--log]" << std::endl;
+            std::cout << "       TextRPGBench actions [count] [rounds]" << std::endl;
+            std::cout << "       TextRPGBench combat [runs] [threads]" << std::endl;
+            std::cout << "       TextRPGBench entities [count] [rounds]" << std::endl;
+            return 0;
+        }
+        else if (bench.empty()) {
+            bench = arg;
+        }
+        else {
+            size_t size = std::strtoul(arg.c_str(), nullptr, 10);
+            if (size == 0) {
+                std::cerr << "[-] Invalid size " << arg << std::endl;
+                return 1;
+            }
+            sizes.push_back(size);
+        }
+    }
+
+    if (logToFile) {
+        LogSinkRegistry::instance().setDefaultSink("bench.log", LogFormat::TEXT);
+        AsyncLogWriter::instance().start();
+    }
+    else {
+        LogSinkRegistry::instance().setDefaultSink("", LogFormat::TEXT);
+    }
+
+    if (bench.empty() || bench == "dialogue") {
+        if (sizes.empty())
+            sizes = { 10000, 100000, 1000000 };
+        runDialogueBench(sizes);
+        return 0;
+    }
+
+    if (bench == "playthrough") {
+        runPlaythroughBench(sizes.size() > 0 ? sizes[0] : 1000, sizes.size() > 1 ? sizes[1] : 100000);
+        return 0;
+    }
+
+    if (bench == "actions") {
+        runActionBench(sizes.size() > 0 ? sizes[0] : 100000, sizes.size() > 1 ? sizes[1] : 100);
+        return 0;
+    }
+
+    if (bench == "combat") {
+        runCombatBench(sizes.size() > 0 ? sizes[0] : 1000000, sizes.size() > 1 ? static_cast<unsigned>(sizes[1]) : 0);
+        return 0;
+    }
+
+    if (bench == "entities") {
+        runEntityBench(sizes.size() > 0 ? sizes[0] : 100000, sizes.size() > 1 ? sizes[1] : 20);
+        return 0;
+    }
+
+    std::cerr << "[-] Unknown benchmark " << bench << std::endl;
+    return 1;
+}